@@ -45,6 +45,10 @@ int pinetime_boot_display_image(void);
 /// will be drawn in color1, the rest in color2.
 int pinetime_boot_display_image_colors(uint16_t color1, uint16_t color2, uint8_t colorLine);
 
+/// Recolor the boot logo already on the display, like pinetime_boot_display_image_colors(). Only the rows
+/// that change color since the last call are sent to the display.
+int pinetime_boot_update_image_colors(uint16_t color1, uint16_t color2, uint8_t colorLine);
+
 /// Display the bootloader version to ST7789 display controller
 int pinetime_version_image(void);
 
@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_DELTA_H__
+#define __PINETIME_DELTA_H__
+#include <stdint.h>
+
+/// Delta image in the secondary slot (tools/delta_pack.py): this header, followed by a stream of operations that
+/// rebuild the new MCUBoot image from the image in the primary slot. Valid if magic and crc match.
+struct pinetime_delta_header {
+  uint32_t magic;         //  PINETIME_DELTA_MAGIC
+  uint32_t size;          //  Size of the new image
+  uint32_t source_size;   //  Size of the primary slot image that the delta applies to
+  uint32_t delta_size;    //  Size of the operation stream after the header
+  uint8_t source_sha256[32];  //  SHA-256 of the first source_size bytes of the primary slot
+  uint8_t delta_sha256[32];   //  SHA-256 of the operation stream
+  uint32_t crc;           //  CRC-32 of the bytes above
+};
+#define PINETIME_DELTA_MAGIC 0x31445450  //  "PTD1"
+
+//  Operations of the stream, little endian
+#define PINETIME_DELTA_COPY   0  //  uint32_t offset, uint32_t length: copy length bytes of the primary slot at offset
+#define PINETIME_DELTA_INSERT 1  //  uint32_t length, then length bytes to insert
+
+/// If the secondary slot holds a delta image, rebuild the full image in the secondary slot for MCUBoot to swap in.
+/// A rebuild interrupted by a reset is resumed by calling this again.
+/// Returns 1 if an image was rebuilt, 0 if there is no delta image, -1 if the delta image doesn't apply to the
+/// primary slot or is damaged.
+int pinetime_delta_apply(void);
+
+#endif
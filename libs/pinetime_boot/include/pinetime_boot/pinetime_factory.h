@@ -1,9 +1,35 @@
 #ifndef __PINETIME_FACTORY_H__
 #define __PINETIME_FACTORY_H__
 
-/// Copy the recovery firmware from the external SPI Flash memory to the secondary slot.
-/// It'll be installed in the primary slot by MCUBoot.
-void restore_factory(void);
+/// Copy the recovery firmware from the external SPI Flash memory to the secondary slot, decompressing it if it was
+/// packed by tools/factory_pack.py. It'll be installed in the primary slot by MCUBoot.
+/// Only the sectors spanned by the MCUBoot image (header, image and TLVs) are copied. Sectors of the secondary slot
+/// that already hold the same data are left alone, blank sectors are programmed without erasing.
+/// The SHA-256 of the image is checked while comparing, before anything is written, and every write is read back.
+/// Returns the number of sectors rewritten, -1 if the recovery firmware is not valid (nothing is changed), or -2 if
+/// the secondary slot doesn't hold the data written.
+int restore_factory(void);
 
+/// Check the SHA-256 of the recovery firmware and install it directly in the primary slot, for
+/// PINETIME_BOOT_DIRECT_RECOVERY. Every attempt appends a PINETIME_ACTION_INSTALL_STARTED record to the boot log, and
+/// a PINETIME_ACTION_INSTALL_UNVERIFIED record if the primary slot doesn't hold the data written. If one of them is
+/// the last record, the install was not completed and must be resumed by calling this again.
+/// Returns 0 if installed, -1 if the recovery firmware is not valid (nothing is changed), or -2 if the primary slot
+/// doesn't hold the data written (the install is resumed at the next boot).
+int install_factory(void);
 
-#endif
\ No newline at end of file
+/// Install an update compressed by tools/factory_pack.py --update in the secondary slot directly in the primary
+/// slot, for PINETIME_BOOT_COMPRESSED_UPDATE. Call it when a swap is pending: the SHA-256 of the update is checked,
+/// then it is decompressed over the primary slot and the trailer of the secondary slot is erased, so that MCUBoot has
+/// nothing to swap. The update can't be reverted. Every attempt appends a PINETIME_ACTION_UPDATE_STARTED record to
+/// the boot log, and a PINETIME_ACTION_UPDATE_UNVERIFIED record if the data written doesn't read back. An install
+/// interrupted by a reset leaves the swap pending and is resumed by calling this again.
+/// Returns 1 if installed, 0 if the secondary slot doesn't hold a compressed image (nothing is changed), -1 if the
+/// update is not valid (nothing is changed), or -2 if the primary slot doesn't hold the data written.
+int install_compressed_update(void);
+
+/// Return non-zero if the secondary slot holds an update compressed by tools/factory_pack.py --update
+int has_compressed_update(void);
+
+
+#endif
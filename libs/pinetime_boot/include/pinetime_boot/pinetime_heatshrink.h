@@ -0,0 +1,49 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_HEATSHRINK_H__
+#define __PINETIME_HEATSHRINK_H__
+#include <stdint.h>
+
+/// heatshrink parameters of the compressed images: 2^8 byte window, matches of up to 2^4 bytes.
+/// tools/factory_pack.py must use the same values.
+#define PINETIME_HEATSHRINK_WINDOW_SZ2    8
+#define PINETIME_HEATSHRINK_LOOKAHEAD_SZ2 4
+
+/// Streaming heatshrink decoder, reading the compressed data from flash. The state is small enough to be copied, so
+/// that a caller can go back to an earlier position without decompressing from the start.
+struct pinetime_heatshrink {
+  int device;               //  Flash device of the compressed data
+  uint32_t input;           //  Flash offset of the next input batch
+  uint8_t in_buf[32];       //  Current input batch
+  uint8_t in_pos;           //  Next byte of in_buf
+  uint8_t bit_mask;         //  Next bit of in_byte, 0 if a new byte must be read
+  uint8_t in_byte;
+  uint16_t count;           //  Bytes left to copy from the window for the current match
+  uint16_t distance;        //  Distance of the current match
+  uint16_t head;            //  Next position in the window
+  uint8_t window[1 << PINETIME_HEATSHRINK_WINDOW_SZ2];  //  Last bytes decompressed
+};
+
+/// Start decompressing the data at offset of the flash device
+void pinetime_heatshrink_init(struct pinetime_heatshrink *hs, int device, uint32_t offset);
+
+/// Decompress the next len bytes into buf. The caller must not read beyond the decompressed size.
+void pinetime_heatshrink_read(struct pinetime_heatshrink *hs, uint8_t *buf, uint32_t len);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_INFO_H__
+#define __PINETIME_INFO_H__
+#include <stdint.h>
+#include "pinetime_boot/pinetime_timing.h"
+
+/// Address of the info block in RAM. The bootloader doesn't use the last 256 bytes of RAM (see boot-nrf52xxaa.ld)
+/// and the firmware must not initialise them before reading the block.
+#define PINETIME_INFO_ADDRESS 0x2000FF00
+#define PINETIME_INFO_MAGIC   0x464e4950  //  "PINF"
+#define PINETIME_INFO_VERSION 1           //  Incremented when the layout changes. New fields are only added at the end.
+
+/// Action chosen by the bootloader
+enum pinetime_action {
+  PINETIME_ACTION_RUN = 0,       //  Run the firmware, after a swap by MCUBoot if one is pending
+  PINETIME_ACTION_REVERT = 1,    //  Button held for 2 seconds: revert to the previous firmware
+  PINETIME_ACTION_RECOVERY = 2,  //  Button held for 4 seconds: install the recovery firmware
+  PINETIME_ACTION_INSTALL = 3,   //  Same with PINETIME_BOOT_DIRECT_RECOVERY: install it directly in the primary slot
+  PINETIME_ACTION_INSTALL_STARTED = 4,  //  Only in the boot log: direct install in progress, resumed at the next boot
+  PINETIME_ACTION_INSTALL_FAILED = 5,   //  Direct install given up: the primary slot may be partly written
+  PINETIME_ACTION_UPDATE_STARTED = 6,   //  Only in the boot log: install of a compressed update in progress
+  PINETIME_ACTION_INSTALL_UNVERIFIED = 7,  //  Only in the boot log: a direct install didn't read back the data written
+  PINETIME_ACTION_UPDATE_UNVERIFIED = 8,   //  Only in the boot log: same for the install of a compressed update
+};
+
+/// Outcome of the swap asked of MCUBoot, found by comparing the primary slot image header before and after MCUBoot ran
+enum pinetime_swap_outcome {
+  PINETIME_SWAP_NONE = 0,      //  No swap requested, or the bootloader restarted before MCUBoot ran
+  PINETIME_SWAP_DONE = 1,      //  The primary slot holds another image. After a TEST swap, the new firmware must
+                               //  confirm itself or MCUBoot reverts it at the next boot.
+  PINETIME_SWAP_REJECTED = 2,  //  The primary slot still holds the same image: MCUBoot rejected the new image
+};
+
+/// Bootloader to firmware info block, at PINETIME_INFO_ADDRESS. Valid if magic, version and crc match.
+struct pinetime_info {
+  uint32_t magic;               //  PINETIME_INFO_MAGIC
+  uint16_t version;             //  PINETIME_INFO_VERSION
+  uint16_t size;                //  Size of the block in bytes, crc included
+  uint32_t bootloader_version;  //  Same as NRF_TIMER2->CC[0]
+  uint32_t reset_reason;        //  NRF_POWER->RESETREAS at startup
+  uint32_t button_ms;           //  Time the button was held during the wait, in milliseconds
+  uint8_t action;               //  enum pinetime_action
+  uint8_t requested_swap_type;  //  boot_swap_type() before MCUBoot ran: BOOT_SWAP_TYPE_NONE, TEST, PERM or REVERT.
+                                //  This is the swap asked of MCUBoot, not its outcome: MCUBoot still checks the image
+                                //  and may reject it and start the current firmware: see swap_outcome.
+  uint8_t swap_outcome;         //  enum pinetime_swap_outcome, set just before the firmware starts
+  uint8_t reserved;
+  struct pinetime_timing timing;  //  Boot phase timings
+  uint32_t flash_erases;        //  Number of flash sectors erased by the bootloader
+  uint32_t flash_writes;        //  Number of flash writes by the bootloader
+  uint32_t flash_bytes_written; //  Number of bytes written to flash by the bootloader
+  uint32_t crc;                 //  CRC-32 (IEEE) of the bytes above
+};
+
+/// Info block of the current boot
+extern struct pinetime_info pinetime_info;
+
+/// Start a new info block
+void pinetime_info_init(void);
+
+/// Count a flash operation by the bootloader
+void pinetime_info_flash_erase(uint32_t sectors);
+void pinetime_info_flash_write(uint32_t bytes);
+
+/// Compute the CRC of the info block. Called before the firmware starts, or before a reset.
+void pinetime_info_seal(void);
+
+/// CRC-32 (IEEE) of len bytes, as used by the info block and the boot log
+uint32_t pinetime_crc32(const void *data, uint32_t len);
+
+#endif
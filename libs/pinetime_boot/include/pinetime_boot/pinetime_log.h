@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_LOG_H__
+#define __PINETIME_LOG_H__
+#include <stdint.h>
+
+/// Boot log in FLASH_AREA_REBOOT_LOG (internal flash 0x7000): an array of records appended once per boot. The page is
+/// only erased when it is full.
+#define PINETIME_LOG_ADDRESS 0x7000
+#define PINETIME_LOG_SIZE    0x1000
+
+/// Boot log record. A slot is empty if sequence is 0xFFFFFFFF, and the record is valid if crc matches.
+struct pinetime_log_record {
+  uint32_t sequence;            //  Incremented on every record, also across page erases
+  uint32_t bootloader_version;
+  uint32_t reset_reason;        //  NRF_POWER->RESETREAS at startup: watchdog and lockup point to a fault
+  uint8_t action;               //  enum pinetime_action
+  uint8_t requested_swap_type;  //  boot_swap_type() before MCUBoot ran
+  uint16_t button_ms;           //  Time the button was held, in milliseconds
+  uint32_t boot_ms;             //  Time from pinetime_boot_init() to the start of the firmware, wait included
+  uint32_t mcuboot_ms;          //  Time spent in MCUBoot: image validation and swap
+  uint16_t flash_erases;        //  Number of flash sectors erased by the bootloader, saturated at 0xFFFF
+  uint8_t swap_outcome;         //  enum pinetime_swap_outcome
+  uint8_t reserved;
+  uint32_t crc;                 //  CRC-32 of the bytes above
+};
+
+/// Append a record for the current boot, built from the info block
+void pinetime_log_append(void);
+
+/// Return the action of the last valid record, or -1 if the log is empty
+int pinetime_log_last_action(void);
+
+/// Return the number of valid records with the action failed at the end of the log, back to the last record whose
+/// action is neither failed nor started
+uint32_t pinetime_log_failures(int failed, int started);
+
+#endif
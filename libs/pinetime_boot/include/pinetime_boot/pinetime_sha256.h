@@ -0,0 +1,41 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_SHA256_H__
+#define __PINETIME_SHA256_H__
+#include <stdint.h>
+
+#define PINETIME_SHA256_SIZE 32  //  Size of a digest in bytes
+
+/// SHA-256 context, for hashing images while they are read from flash
+struct pinetime_sha256 {
+  uint32_t state[8];
+  uint32_t length;     //  Number of bytes hashed so far
+  uint8_t block[64];   //  Pending bytes of the current block
+};
+
+/// Start a new hash
+void pinetime_sha256_init(struct pinetime_sha256 *ctx);
+
+/// Hash len more bytes
+void pinetime_sha256_update(struct pinetime_sha256 *ctx, const void *data, uint32_t len);
+
+/// Finish the hash and store the digest
+void pinetime_sha256_final(struct pinetime_sha256 *ctx, uint8_t digest[PINETIME_SHA256_SIZE]);
+
+#endif
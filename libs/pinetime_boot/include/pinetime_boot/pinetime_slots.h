@@ -0,0 +1,40 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_SLOTS_H__
+#define __PINETIME_SLOTS_H__
+
+/// Flash layout of the MCUBoot slots and of the recovery firmware. The slots must match FLASH_AREA_IMAGE_0 and
+/// FLASH_AREA_IMAGE_1 in hw/bsp/nrf52/bsp.yml. tools/pinetime_slots.py reads the values from this file.
+/// The MCUBoot image trailer is in the last sector of a slot.
+#define PINETIME_PRIMARY_DEVICE   0        //  FLASH_AREA_IMAGE_0 in Internal Flash ROM
+#define PINETIME_PRIMARY_OFFSET   0x8000
+#define PINETIME_SECONDARY_DEVICE 1        //  FLASH_AREA_IMAGE_1 in External SPI Flash
+#define PINETIME_SECONDARY_OFFSET 0x40000
+#define PINETIME_SLOT_SIZE        0x74000
+#define PINETIME_RECOVERY_DEVICE  1        //  Recovery firmware at the start of External SPI Flash
+#define PINETIME_RECOVERY_OFFSET  0
+#define PINETIME_RECOVERY_SIZE    0x40000
+
+/// Erase unit of both flash devices
+#define PINETIME_SECTOR_SIZE      0x1000
+
+/// Flash reads and writes are done in batches of one SPI Flash page
+#define PINETIME_BATCH_SIZE       256
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_TICKER_H__
+#define __PINETIME_TICKER_H__
+#include <stdint.h>
+
+/// Start a periodic tick at hz ticks per second (TIMER4).
+void pinetime_ticker_start(uint32_t hz);
+
+/// Sleep until the next tick. The CPU waits in WFE between ticks. Return the number of ticks since the previous call
+/// (since the start for the first call): more than 1 when the CPU was busy past a tick.
+uint32_t pinetime_ticker_wait(void);
+
+/// Stop the tick and hand TIMER4 back in its reset state, before the firmware starts.
+void pinetime_ticker_stop(void);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef __PINETIME_TIMING_H__
+#define __PINETIME_TIMING_H__
+#include <stdint.h>
+
+/// Boot phases timed with the DWT cycle counter. Each phase is recorded when it ends.
+enum pinetime_phase {
+  PINETIME_PHASE_BOOT_INIT,     //  pinetime_boot_init() called by sysinit(): the cycle counter starts here
+  PINETIME_PHASE_DISPLAY_INIT,  //  Display controller initialised
+  PINETIME_PHASE_LOGO,          //  Boot logo drawn
+  PINETIME_PHASE_VERSION,       //  Version drawn
+  PINETIME_PHASE_WAIT,          //  Wait for the button done
+  PINETIME_PHASE_MCUBOOT,       //  MCUBoot done with image validation and swap: boot_custom_start() called
+  PINETIME_PHASE_VECTOR_TABLE,  //  relocate_vector_table() done
+  PINETIME_PHASE_START,         //  Firmware about to start
+  PINETIME_PHASE_COUNT
+};
+
+#define PINETIME_TIMING_MAGIC 0x504d4954  //  "TIMP"
+
+/// Phase table handed to the firmware in the info block (pinetime_info.h), whose address is also stored in
+/// NRF_TIMER2->CC[1], next to the bootloader version in NRF_TIMER2->CC[0]
+struct pinetime_timing {
+  uint32_t magic;                        //  PINETIME_TIMING_MAGIC
+  uint32_t cpu_hz;                       //  Cycle counter frequency
+  uint32_t count;                        //  Number of entries in cycles
+  uint32_t cycles[PINETIME_PHASE_COUNT]; //  Cycle counter at the end of each phase
+  uint32_t wait_ms;                      //  Duration of the wait for the button. The cycle counter stops while the
+                                         //  CPU sleeps, so PINETIME_PHASE_WAIT only counts the CPU time of the wait.
+};
+
+/// Start the cycle counter and record PINETIME_PHASE_BOOT_INIT
+void pinetime_timing_start(void);
+
+/// Record the end of a phase
+void pinetime_timing_mark(enum pinetime_phase phase);
+
+/// Record the duration of the wait for the button, in milliseconds
+void pinetime_timing_wait_ms(uint32_t ms);
+
+/// Print the phase table on the console if semihosting is enabled, and store the info block address in
+/// NRF_TIMER2->CC[1]
+void pinetime_timing_report(void);
+
+#endif
@@ -25,11 +25,14 @@
 #include <hal/hal_flash_int.h>
 #include <hal/hal_gpio.h>
 #include <hal/hal_spi.h>
+#include <nrf.h>
 #include <stdio.h>
 #include <string.h>
 #include "pinetime_boot/pinetime_boot.h"
 #include "pinetime_boot/pinetime_delay.h"
+#include "pinetime_boot/pinetime_timing.h"
 #include "graphic.h"
+#include "spim_dma.h"
 //  GPIO Pins. From rust\piet-embedded\piet-embedded-graphics\src\display.rs
 #define DISPLAY_SPI   0  //  Mynewt SPI port 0
 #define DISPLAY_CS   25  //  LCD_CS (P0.25): Chip select
@@ -39,6 +42,9 @@
 #define DISPLAY_MEDIUM 22  //  LCD_BACKLIGHT_MEDIUM (P0.22): Backlight (active low)
 #define DISPLAY_HIGH 23  //  LCD_BACKLIGHT_HIGH (P0.23): Backlight (active low)
 #define BATCH_SIZE  256  //  Max number of SPI data bytes to be transmitted
+#define MAX_SPANS   16   //  Max number of foreground spans per row drawn with their own address window
+#define SPAN_COST   32   //  Cost of the address window for a span, in bytes of pixel data: 11 bytes of commands and
+                         //  parameters, plus the CS, DC and SPI setup of their transactions
 #define PUSH_BUTTON_IN  13  //  GPIO Pin P0.13: PUSH BUTTON_IN
 
 //  Screen Size
@@ -73,6 +79,8 @@
 #define PTLAR 0x30
 #define COLMOD 0x3A
 #define MADCTL 0x36
+#define VSCSAD 0x37
+#define IDMOFF 0x38
 #define FRMCTR1 0xB1
 #define FRMCTR2 0xB2
 #define FRMCTR3 0xB3
@@ -92,77 +100,170 @@
 #define GMCTRP1 0xE0
 #define GMCTRN1 0xE1
 
+//  ST7789 init tables: command, number of parameters, delay in milliseconds after the command, parameters.
+//  Delays are the datasheet minimums. After a reset the panel is in Sleep In, and Sleep Out must wait 120 ms from the
+//  reset; the commands in between take far less, so the wait goes after SWRESET. Sleep Out needs 5 ms before the
+//  next command. Display On needs none.
+#if MYNEWT_VAL(PINETIME_BOOT_DISPLAY_PANEL) == 0
+//  Original PineTime sequence
+static const uint8_t init_table[] = {
+    SWRESET, 0, 120,
+    FRMCTR1, 3, 0,  0x01, 0x2C, 0x2D,
+    FRMCTR2, 3, 0,  0x01, 0x2C, 0x2D,
+    FRMCTR3, 6, 0,  0x01, 0x2C, 0x2D, 0x01, 0x2C, 0x2D,
+    INVCTR,  1, 0,  0x07,
+    PWCTR1,  3, 0,  0xA2, 0x02, 0x84,
+    PWCTR2,  1, 0,  0xC5,
+    PWCTR3,  2, 0,  0x0A, 0x00,
+    PWCTR4,  2, 0,  0x8A, 0x2A,
+    PWCTR5,  2, 0,  0x8A, 0xEE,
+    VMCTR1,  1, 0,  0x0E,
+    INVERTED ? INVON : INVOFF, 0, 0,
+    MADCTL,  1, 0,  RGB ? 0x00 : 0x08,
+    COLMOD,  1, 0,  0x05,
+    SLPOUT,  0, 5,
+    DISPON,  0, 0,
+};
+#elif MYNEWT_VAL(PINETIME_BOOT_DISPLAY_PANEL) == 1
+//  Minimal sequence for panels that work with the ST7789 power-on defaults
+static const uint8_t init_table[] = {
+    SWRESET, 0, 120,
+    COLMOD,  1, 0,  0x55,
+    MADCTL,  1, 0,  RGB ? 0x00 : 0x08,
+    INVERTED ? INVON : INVOFF, 0, 0,
+    NORON,   0, 0,
+    SLPOUT,  0, 5,
+    DISPON,  0, 0,
+};
+#else
+#error "Unknown PINETIME_BOOT_DISPLAY_PANEL"
+#endif
+
+//  Init table after a warm reset, when the panel kept its power and its configuration from the firmware. Bring it back
+//  to the state expected by the bootloader: awake, normal mode, no scrolling, 16-bit colour, display on.
+static const uint8_t warm_init_table[] = {
+    SLPOUT,  0, 5,
+    NORON,   0, 0,
+    IDMOFF,  0, 0,
+    VSCSAD,  2, 0,  0x00, 0x00,
+    COLMOD,  1, 0,  0x55,
+    INVERTED ? INVON : INVOFF, 0, 0,
+    DISPON,  0, 0,
+};
+
 //  ST7789 Orientation. From https://github.com/lupyuen/st7735-lcd-batch-rs/blob/master/src/lib.rs#L52-L58
 #define Portrait 0x00
 #define Landscape 0x60
 #define PortraitSwapped 0xC0
 #define LandscapeSwapped 0xA0
 
+/// Part of a display transaction: len bytes of data sent with the data/command pin at level dc
+struct spiSegment {
+    uint8_t dc;           //  0 for command, 1 for data
+    const uint8_t *data;
+    uint16_t len;
+};
+
 static int init_display(void);
+static int run_init_table(const uint8_t *table, uint16_t size);
+static int is_warm_reset(void);
 static int set_window(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom);
 static int hard_reset(void);
 static int set_orientation(uint8_t orientation);
 static int write_command(uint8_t command, const uint8_t *params, uint16_t len);
-static int write_data(const uint8_t *data, uint16_t len);
+static int write_data_async(const uint8_t *data, uint16_t len);
+static int write_data_dma(const uint8_t *data, uint8_t chunk_len, uint16_t count, int mode);
+static int fill_rect(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom, uint16_t color);
+static int transmit_segments(const struct spiSegment *segments, int count);
+static void select_display(void);
+static void wait_dma(void);
+static void wait_spi(void);
 static int transmit_spi(const uint8_t *data, uint16_t len);
 
-/// Buffer for reading flash and writing to display
-static uint8_t flash_buffer[COL_COUNT * BYTES_PER_PIXEL];
+/// Colors of an image drawn with pinetime_display_image_colors(): rows above colorLine in color1, the rest in color2
+struct imgColors {
+  uint16_t color1;
+  uint16_t color2;
+  uint8_t colorLine;
+};
+
+/// Position of the RLE decoder in an image
+struct rleCursor {
+  const struct imgInfo* info;
+  uint16_t index;        //  Index of the next run in info->data
+  uint16_t remaining;    //  Number of pixels left in the current run
+  uint8_t isBackground;  //  Non-zero if the current run is drawn in the background color
+  uint8_t runRow;        //  Row of the first pixel of the current run, which selects its color
+  uint16_t color;        //  2-bit images: color of the current run
+  uint16_t palette[4];   //  2-bit images: current palette in RGB565
+};
+
+/// Foreground spans of a decoded row: ranges of consecutive pixels that are not in the background color
+struct rowSpans {
+  uint8_t count;     //  Number of spans in span
+  uint8_t overflow;  //  Non-zero if the row has more than MAX_SPANS spans
+  struct {
+    uint8_t left;
+    uint8_t right;
+    uint8_t dirty;   //  Non-zero if a pixel of the span changes color
+  } span[MAX_SPANS];
+};
+
+static int draw_image(const struct imgInfo* info, int posX, int posY, const struct imgColors* colors, const struct imgColors* previous, int onBackground);
+static void seek_row(struct rleCursor* cursor, const struct imgInfo* info, uint8_t y);
+static int decode_row(struct rleCursor* cursor, uint8_t y, uint8_t* buffer, struct rowSpans* spans, const struct imgColors* colors, const struct imgColors* previous);
+static void fetch_run_2bit(struct rleCursor* cursor);
+static uint16_t clut8_rgb565(uint8_t i);
+
+/// Row buffers for writing to display: one row is decoded by the CPU while the other one is sent by EasyDMA
+static uint8_t row_buffers[2][COL_COUNT * BYTES_PER_PIXEL];
+
+/// Non-zero while write_data_async() is sending a row buffer to the display
+static int dma_pending = 0;
+
+/// Non-zero while the display is selected, between the start of a transaction and wait_spi()
+static int display_selected = 0;
+
+/// Colors of the boot logo currently on the display, for pinetime_boot_update_image_colors()
+static struct imgColors bootLogoColors;
 
 /// Display the image described by info to the ST7789 display controller using 2 colors. The first x lines (x = colorLine)
 /// will be drawn in color1, the rest in color2.
 int pinetime_display_image_colors(struct imgInfo* info, int posX, int posY, uint16_t color1, uint16_t color2, uint8_t colorLine) {
-  int rc;
-  int y = 0;
-  uint16_t bufferIndex = 0;
-  uint8_t isBackground = 1;
-  const uint16_t backgroundColor = BLACK;
-  uint16_t trueColor = backgroundColor;
-
-  for (int i = 0; i < info->dataSize; i++) {
-    uint8_t runLength = info->data[i];
-    while (runLength) {
-      flash_buffer[bufferIndex] = trueColor >> 8;
-      flash_buffer[bufferIndex + 1] = trueColor & 0xff;
-      bufferIndex += BYTES_PER_PIXEL;
-      runLength -= 1;
-
-      if (bufferIndex >= (info->width * BYTES_PER_PIXEL)) {
-        rc = set_window(posX, y + posY, posX + info->width - 1, y + posY); assert(rc == 0);
-
-        //  Write Pixels (RAMWR): st7735_lcd::draw() → set_pixel()
-        rc = write_command(RAMWR, NULL, 0); assert(rc == 0);
-        rc = write_data(flash_buffer, info->width * BYTES_PER_PIXEL); assert(rc == 0);
-        bufferIndex = 0;
-        y += 1;
-      }
-    }
-
-    if (isBackground) {
-      isBackground = 0;
-      trueColor = (y < colorLine) ? color1 : color2;
-    }
-    else {
-      isBackground = 1;
-      trueColor = backgroundColor;
-    }
-    if(y >= info->height)
-      break;
-  }
-  return 0;
+  const struct imgColors colors = { color1, color2, colorLine };
+  return draw_image(info, posX, posY, &colors, NULL, 0);
 }
 
 /// Clear the display
 void pinetime_clear_screen(void) {
-  int rc = 0;
-  for(int i = 0 ; i < COL_COUNT * BYTES_PER_PIXEL; i++) {
-    flash_buffer[i] = 0;
+  int rc = fill_rect(0, 0, COL_COUNT - 1, ROW_COUNT - 1, BLACK); assert(rc == 0);
+}
+
+/// Fill the rectangle (left, top), (right, bottom) with color. A single address window is opened and EasyDMA sends
+/// the same small buffer of pixels again and again, with no per-row CPU work.
+static int fill_rect(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom, uint16_t color) {
+  uint32_t pixels = (uint32_t) (right - left + 1) * (bottom - top + 1);
+  int rc = set_window(left, top, right, bottom); assert(rc == 0);
+
+  //  No transfer is pending after set_window(), so the row buffer is free
+  uint8_t *buffer = row_buffers[0];
+  uint16_t chunk = SPIM_DMA_MAX_CHUNK / BYTES_PER_PIXEL;
+  if (chunk > pixels) { chunk = pixels; }
+  for (int i = 0; i < chunk; i++) {
+    buffer[i * BYTES_PER_PIXEL] = color >> 8;
+    buffer[i * BYTES_PER_PIXEL + 1] = color & 0xff;
+  }
+  uint32_t count = pixels / chunk;
+  while (count > 0) {
+    uint16_t repeat = (count > 0xffff) ? 0xffff : count;
+    rc = write_data_dma(buffer, chunk * BYTES_PER_PIXEL, repeat, SPIM_DMA_REPEAT); assert(rc == 0);
+    count -= repeat;
   }
-  for(int i = 0; i < ROW_COUNT; i++) {
-    rc = set_window(0, i, COL_COUNT-1, i); assert(rc == 0);
-    rc = write_command(RAMWR, NULL, 0); assert(rc == 0);
-    rc = write_data(flash_buffer, COL_COUNT * BYTES_PER_PIXEL); assert(rc == 0);
+  if (pixels % chunk) {
+    rc = write_data_async(buffer, (pixels % chunk) * BYTES_PER_PIXEL); assert(rc == 0);
   }
+  wait_spi();
+  return 0;
 }
 
 /// Display the image described by info at position (posX, posY) using default color (black and white)
@@ -175,15 +276,263 @@ int pinetime_boot_display_image(void) {
   console_printf("Displaying boot logo...\n");  console_flush();
 
   int rc = init_display();  assert(rc == 0);
+  pinetime_timing_mark(PINETIME_PHASE_DISPLAY_INIT);
   rc = set_orientation(Landscape);  assert(rc == 0);
   pinetime_clear_screen();
-  return pinetime_display_image(&bootLogoInfo, 0, 0);
+
+  //  The screen is cleared: only send the foreground of the logo
+  const struct imgColors colors = { WHITE, WHITE, 0 };
+  rc = draw_image(&bootLogoInfo, 0, 0, &colors, NULL, 1);
+  bootLogoColors = colors;
+  pinetime_timing_mark(PINETIME_PHASE_LOGO);
+  return rc;
 }
 
 /// Display the boot logo to ST7789 display controller using 2 colors. The first x lines (x = colorLine)
 /// will be drawn in color1, the rest in color2.
 int pinetime_boot_display_image_colors(uint16_t color1, uint16_t color2, uint8_t colorLine) {
-  return pinetime_display_image_colors(&bootLogoInfo, 0, 0, color1, color2, colorLine);
+  const struct imgColors colors = { color1, color2, colorLine };
+  int rc = draw_image(&bootLogoInfo, 0, 0, &colors, NULL, 0);
+  bootLogoColors = colors;
+  return rc;
+}
+
+/// Recolor the boot logo already on the display: same as pinetime_boot_display_image_colors(), but only the rows
+/// whose pixels change color since the last call are sent to the display.
+int pinetime_boot_update_image_colors(uint16_t color1, uint16_t color2, uint8_t colorLine) {
+  const struct imgColors colors = { color1, color2, colorLine };
+  int rc = draw_image(&bootLogoInfo, 0, 0, &colors, &bootLogoColors, 1);
+  bootLogoColors = colors;
+  return rc;
+}
+
+/// Return the color of a foreground run starting at row y
+static uint16_t foreground_color(const struct imgColors* colors, uint8_t y) {
+  return (y < colors->colorLine) ? colors->color1 : colors->color2;
+}
+
+/// Draw the image described by info at position (posX, posY). If previous is not NULL, the display already shows the
+/// image drawn with the previous colors and only the rows that change color are sent.
+/// Consecutive rows are streamed into a single address window and RAMWR, the display controller wraps to the next row
+/// of the window by itself. Row N+1 is decoded while row N is sent.
+/// If onBackground is non-zero, the display already shows the background color under the image (e.g. after
+/// pinetime_clear_screen()). A row is then sent as its foreground spans only, each in its own address window, unless
+/// the row is too fragmented for the windows to cost less than the background pixels they skip.
+static int draw_image(const struct imgInfo* info, int posX, int posY, const struct imgColors* colors, const struct imgColors* previous, int onBackground) {
+  int rc;
+  struct rleCursor cursor;
+  struct rowSpans spans;
+  int windowOpen = 0;  //  Non-zero if the next row continues the current RAMWR
+  int bufferIndex = 0;
+
+  //  If only colorLine moves, no row above both lines changes color, and no row below both lines either, except for
+  //  the rows covered by a foreground run that starts above them.
+  uint8_t firstLine = 0;
+  uint8_t lastLine = 0;
+  if (previous != NULL && previous->color1 == colors->color1 && previous->color2 == colors->color2) {
+    firstLine = (previous->colorLine < colors->colorLine) ? previous->colorLine : colors->colorLine;
+    lastLine = (previous->colorLine > colors->colorLine) ? previous->colorLine : colors->colorLine;
+  }
+  if (firstLine > info->height) { firstLine = info->height; }
+  seek_row(&cursor, info, firstLine);
+
+  for (int y = firstLine; y < info->height; y++) {
+    if (lastLine && y >= lastLine && !(cursor.remaining && !cursor.isBackground && cursor.runRow < lastLine)) {
+      break;
+    }
+    uint8_t* buffer = row_buffers[bufferIndex];
+    int dirty = decode_row(&cursor, y, buffer, &spans, colors, previous);
+    if (!dirty) {
+      windowOpen = 0;
+      continue;
+    }
+    if ((onBackground || previous != NULL) && !spans.overflow) {
+      //  Compare the cost of the changed spans with the cost of the whole row
+      int spanCost = 0;
+      for (int i = 0; i < spans.count; i++) {
+        if (!spans.span[i].dirty) { continue; }
+        spanCost += (spans.span[i].right - spans.span[i].left + 1) * BYTES_PER_PIXEL + SPAN_COST;
+      }
+      int rowCost = info->width * BYTES_PER_PIXEL + (windowOpen ? 0 : SPAN_COST);
+      if (spanCost < rowCost) {
+        for (int i = 0; i < spans.count; i++) {
+          if (!spans.span[i].dirty) { continue; }
+          uint8_t left = spans.span[i].left;
+          uint8_t right = spans.span[i].right;
+          rc = set_window(posX + left, posY + y, posX + right, posY + y); assert(rc == 0);
+          rc = write_data_async(buffer + left * BYTES_PER_PIXEL, (right - left + 1) * BYTES_PER_PIXEL); assert(rc == 0);
+        }
+        windowOpen = 0;
+        if (spanCost > 0) { bufferIndex ^= 1; }
+        continue;
+      }
+    }
+    if (!windowOpen) {
+      rc = set_window(posX, posY + y, posX + info->width - 1, posY + info->height - 1); assert(rc == 0);
+      windowOpen = 1;
+    }
+    rc = write_data_async(buffer, info->width * BYTES_PER_PIXEL); assert(rc == 0);
+    bufferIndex ^= 1;  //  Decode the next row into the buffer that is not being sent
+  }
+  wait_spi();
+  return 0;
+}
+
+/// Position the cursor at the first pixel of row y. The decoder starts from the nearest row index entry above y,
+/// or from the start of the image if it has no row index.
+static void seek_row(struct rleCursor* cursor, const struct imgInfo* info, uint8_t y) {
+  uint8_t row = 0;
+  cursor->info = info;
+  cursor->index = 0;
+  cursor->remaining = 0;
+  cursor->isBackground = 0;
+  cursor->runRow = 0;
+  if (info->depth == 2) {
+    //  Skip the descriptor and start with the default palette: black, grey25, grey50, white
+    assert(info->dataSize >= 3 && info->data[0] == 2);
+    assert(info->data[1] == info->width && info->data[2] == info->height);
+    assert(info->rowIndexStride == 0);  //  The palette can't be restored from a row index
+    static const uint8_t defaultPalette[4] = { 0, 254, 219, 215 };
+    for (int i = 0; i < 4; i++) { cursor->palette[i] = clut8_rgb565(defaultPalette[i]); }
+    cursor->index = 3;
+  }
+  if (info->rowIndexStride > 0 && y > 0) {
+    const struct imgRowIndex* entry = &info->rowIndex[(y < info->height ? y : info->height - 1) / info->rowIndexStride];
+    row = (entry - info->rowIndex) * info->rowIndexStride;
+    cursor->index = entry->index;
+    cursor->remaining = entry->remaining;
+    cursor->runRow = entry->runRow;
+    //  The current run is the one before the next run
+    cursor->isBackground = cursor->remaining && !((cursor->index - 1) & 1);
+  }
+  //  Skip the remaining rows
+  for (; row < y; row++) {
+    decode_row(cursor, row, NULL, NULL, NULL, NULL);
+  }
+}
+
+/// Decode row y of the image at the cursor into buffer, or skip the row if buffer is NULL. The foreground spans of the
+/// row are returned in spans. Return non-zero if the row must be sent to the display, i.e. previous is NULL or a pixel
+/// of the row was drawn in a different color with the previous colors.
+static int decode_row(struct rleCursor* cursor, uint8_t y, uint8_t* buffer, struct rowSpans* spans, const struct imgColors* colors, const struct imgColors* previous) {
+  const struct imgInfo* info = cursor->info;
+  int dirty = (previous == NULL);
+  int x = 0;
+  if (spans != NULL) {
+    spans->count = 0;
+    spans->overflow = 0;
+  }
+  while (x < info->width) {
+    //  Fetch the next run. 1-bit runs alternate between background and foreground, starting with background.
+    while (cursor->remaining == 0) {
+      if (cursor->index >= info->dataSize) {
+        //  Truncated image: fill the rest of the row with background
+        cursor->isBackground = 1;
+        cursor->remaining = info->width - x;
+        break;
+      }
+      if (info->depth == 2) {
+        fetch_run_2bit(cursor);
+      } else {
+        cursor->isBackground = !(cursor->index & 1);
+        cursor->remaining = info->data[cursor->index++];
+      }
+      cursor->runRow = y;
+    }
+
+    int count = info->width - x;
+    if (count > cursor->remaining) { count = cursor->remaining; }
+    cursor->remaining -= count;
+
+    uint16_t color = BLACK;
+    if (buffer != NULL && !cursor->isBackground) {
+      int changed;
+      if (info->depth == 2) {
+        //  Palette colors don't depend on the image colors
+        color = cursor->color;
+        changed = (previous == NULL);
+      } else {
+        color = foreground_color(colors, cursor->runRow);
+        changed = (previous == NULL || color != foreground_color(previous, cursor->runRow));
+      }
+      dirty |= changed;
+      if (spans != NULL) {
+        //  Extend the last span if this run follows it, or start a new span
+        if (spans->count > 0 && spans->span[spans->count - 1].right == x - 1) {
+          spans->span[spans->count - 1].right = x + count - 1;
+          spans->span[spans->count - 1].dirty |= changed;
+        } else if (spans->count < MAX_SPANS) {
+          spans->span[spans->count].left = x;
+          spans->span[spans->count].right = x + count - 1;
+          spans->span[spans->count].dirty = changed;
+          spans->count++;
+        } else {
+          spans->overflow = 1;
+        }
+      }
+    }
+    if (buffer == NULL) {
+      x += count;
+      continue;
+    }
+    for (uint8_t* p = buffer + x * BYTES_PER_PIXEL; count > 0; count--) {
+      *p++ = color >> 8;
+      *p++ = color & 0xff;
+      x++;
+    }
+  }
+  return dirty;
+}
+
+/// Fetch the next op of a 2-bit palette image (tools/rle_encode.py --2bit). Each op is a palette index in the top 2
+/// bits and a run length in the low 6 bits. A run length of 0 sets the palette entry to the CLUT color in the next byte
+/// and leaves cursor->remaining at 0. A run length of 63 is followed by extra lengths, up to the first one below 255.
+/// Palette entry 0 is never reprogrammed by the encoder and is the background.
+static void fetch_run_2bit(struct rleCursor* cursor) {
+  const struct imgInfo* info = cursor->info;
+  uint8_t op = info->data[cursor->index++];
+  uint8_t px = op >> 6;
+  uint16_t runLength = op & 0x3f;
+  if (runLength == 0) {
+    if (cursor->index < info->dataSize) {
+      cursor->palette[px] = clut8_rgb565(info->data[cursor->index++]);
+    }
+    return;
+  }
+  if (runLength == 63) {
+    uint8_t extra = 255;
+    while (extra == 255 && cursor->index < info->dataSize) {
+      extra = info->data[cursor->index++];
+      runLength += extra;
+    }
+  }
+  cursor->isBackground = (px == 0);
+  cursor->color = cursor->palette[px];
+  cursor->remaining = runLength;
+}
+
+/// Return the RGB565 color of entry i of the wasp-os CLUT: the 216 web-safe colors, 36 brighter colors and 4 grays.
+/// Same as clut8_rgb565() in tools/rle_encode.py.
+static uint16_t clut8_rgb565(uint8_t i) {
+  uint16_t rgb565;
+  if (i < 216) {
+    uint8_t rg = i / 6;
+    rgb565 = ((i % 6) * 0x33) >> 3;
+    rgb565 += ((rg % 6) * (0x33 << 3)) & 0x07e0;
+    rgb565 += ((rg / 6) * (0x33 << 8)) & 0xf800;
+  } else if (i < 252) {
+    i -= 216;
+    uint8_t rg = i / 3;
+    rgb565 = (0x7f + ((i % 3) * 0x33)) >> 3;
+    rgb565 += ((0x4c << 3) + ((rg % 4) * (0x33 << 3))) & 0x07e0;
+    rgb565 += ((0x7f << 8) + ((rg / 4) * (0x33 << 8))) & 0xf800;
+  } else {
+    i -= 252;
+    uint8_t gr6 = (0x2c + (0x10 * i)) >> 2;
+    uint8_t gr5 = gr6 >> 1;
+    rgb565 = (gr5 << 11) + (gr6 << 5) + gr5;
+  }
+  return rgb565;
 }
 
 /// Display the bootloader version to ST7789 display controller on the bottom of the display (centered)
@@ -192,21 +541,23 @@ int pinetime_version_image(void) {
   return pinetime_display_image(&versionInfo, (COL_COUNT/2) - (versionInfo.width/2), ROW_COUNT - (versionInfo.height));
 }
 
-/// Set the ST7789 display window to the coordinates (left, top), (right, bottom)
+/// Set the ST7789 display window to the coordinates (left, top), (right, bottom) and start writing pixels into it.
+/// The commands are sent in one transaction and the display stays selected for the pixel data that follows.
 static int set_window(uint8_t left, uint8_t top, uint8_t right, uint8_t bottom) {
     assert(left < COL_COUNT && right < COL_COUNT && top < ROW_COUNT && bottom < ROW_COUNT);
     assert(left <= right);
     assert(top <= bottom);
-    //  Set Address Window Columns (CASET): st7735_lcd::draw() → set_pixel() → set_address_window()
-    int rc = write_command(CASET, NULL, 0); assert(rc == 0);
+    static const uint8_t commands[] = { CASET, RASET, RAMWR };
     uint8_t col_para[4] = { 0x00, left, 0x00, right };
-    rc = write_data(col_para, 4); assert(rc == 0);
-
-    //  Set Address Window Rows (RASET): st7735_lcd::draw() → set_pixel() → set_address_window()
-    rc = write_command(RASET, NULL, 0); assert(rc == 0);
     uint8_t row_para[4] = { 0x00, top, 0x00, bottom };
-    rc = write_data(row_para, 4); assert(rc == 0);
-    return 0;
+    const struct spiSegment segments[] = {
+        { 0, &commands[0], 1 },  //  Set Address Window Columns (CASET): st7735_lcd::draw() → set_pixel() → set_address_window()
+        { 1, col_para, 4 },
+        { 0, &commands[1], 1 },  //  Set Address Window Rows (RASET): st7735_lcd::draw() → set_pixel() → set_address_window()
+        { 1, row_para, 4 },
+        { 0, &commands[2], 1 },  //  Write Pixels (RAMWR): st7735_lcd::draw() → set_pixel()
+    };
+    return transmit_segments(segments, sizeof(segments) / sizeof(segments[0]));
 }
 
 /// Runs commands to initialize the display. From https://github.com/lupyuen/st7735-lcd-batch-rs/blob/master/src/lib.rs
@@ -221,60 +572,40 @@ static int init_display(void) {
     rc = hal_gpio_init_out(DISPLAY_MEDIUM, 1); assert(rc == 0);
     rc = hal_gpio_init_out(DISPLAY_HIGH, 1); assert(rc == 0);
 
-    hard_reset();
-    write_command(SWRESET, NULL, 0);
-    pinetime_delay_ms(200);
-
-    static const uint8_t FRMCTR1_PARA[] = { 0x01, 0x2C, 0x2D };
-    write_command(FRMCTR1, FRMCTR1_PARA, sizeof(FRMCTR1_PARA));
-
-    static const uint8_t FRMCTR2_PARA[] = { 0x01, 0x2C, 0x2D };
-    write_command(FRMCTR2, FRMCTR2_PARA, sizeof(FRMCTR2_PARA));
-
-    static const uint8_t FRMCTR3_PARA[] = { 0x01, 0x2C, 0x2D, 0x01, 0x2C, 0x2D };
-    write_command(FRMCTR3, FRMCTR3_PARA, sizeof(FRMCTR3_PARA));
-
-    static const uint8_t INVCTR_PARA[] = { 0x07 };
-    write_command(INVCTR, INVCTR_PARA, sizeof(INVCTR_PARA));
-
-    static const uint8_t PWCTR1_PARA[] = { 0xA2, 0x02, 0x84 };
-    write_command(PWCTR1, PWCTR1_PARA, sizeof(PWCTR1_PARA));
-
-    static const uint8_t PWCTR2_PARA[] = { 0xC5 };
-    write_command(PWCTR2, PWCTR2_PARA, sizeof(PWCTR2_PARA));
-    
-    static const uint8_t PWCTR3_PARA[] = { 0x0A, 0x00 };
-    write_command(PWCTR3, PWCTR3_PARA, sizeof(PWCTR3_PARA));
-    
-    static const uint8_t PWCTR4_PARA[] = { 0x8A, 0x2A };
-    write_command(PWCTR4, PWCTR4_PARA, sizeof(PWCTR4_PARA));
-    
-    static const uint8_t PWCTR5_PARA[] = { 0x8A, 0xEE };
-    write_command(PWCTR5, PWCTR5_PARA, sizeof(PWCTR5_PARA));
-    
-    static const uint8_t VMCTR1_PARA[] = { 0x0E };
-    write_command(VMCTR1, VMCTR1_PARA, sizeof(VMCTR1_PARA));
-
-    if (INVERTED) {
-        write_command(INVON, NULL, 0);
-    } else {
-        write_command(INVOFF, NULL, 0);
+    if (is_warm_reset()) {
+        //  Panel is still powered and configured: skip the reset and the 120 ms wait that follows
+        rc = run_init_table(warm_init_table, sizeof(warm_init_table)); assert(rc == 0);
+        return 0;
     }
-    if (RGB) {
-        static const uint8_t MADCTL1_PARA[] = { 0x00 };
-        write_command(MADCTL, MADCTL1_PARA, sizeof(MADCTL1_PARA));
-    } else {
-        static const uint8_t MADCTL2_PARA[] = { 0x08 };
-        write_command(MADCTL, MADCTL2_PARA, sizeof(MADCTL2_PARA));
-    }
-    static const uint8_t COLMOD_PARA[] = { 0x05 };
-    write_command(COLMOD, COLMOD_PARA, sizeof(COLMOD_PARA));
+    hard_reset();
+    rc = run_init_table(init_table, sizeof(init_table)); assert(rc == 0);
+    return 0;
+}
 
-    write_command(SLPOUT, NULL, 0);
-    pinetime_delay_ms(200);
+/// Return 1 if the CPU was reset without losing power, by a soft reset, the watchdog or a lockup, so that the
+/// display kept its configuration. RESETREAS is only read, the firmware reports the reset reason after us, so its
+/// flags add up until the firmware clears them: a soft reset flag may be left over from an earlier reset. Any other
+/// flag (reset pin, wake from System OFF...) means a cold start, and a power-on or brownout reset clears all flags.
+static int is_warm_reset(void) {
+    if (!MYNEWT_VAL(PINETIME_BOOT_DISPLAY_WARM_START)) { return 0; }
+    uint32_t reason = NRF_POWER->RESETREAS;
+    uint32_t warm = POWER_RESETREAS_SREQ_Msk | POWER_RESETREAS_DOG_Msk | POWER_RESETREAS_LOCKUP_Msk;
+    return (reason & warm) != 0 && (reason & ~warm) == 0;
+}
 
-    write_command(DISPON, NULL, 0);
-    pinetime_delay_ms(200);
+/// Send the commands of an init table to the ST7789. Each entry is the command, the number of parameters, the delay
+/// in milliseconds after the command, then the parameters.
+static int run_init_table(const uint8_t *table, uint16_t size) {
+    const uint8_t *entry = table;
+    while (entry < table + size) {
+        uint8_t command = entry[0];
+        uint8_t len = entry[1];
+        uint8_t delay_ms = entry[2];
+        int rc = write_command(command, (len > 0) ? entry + 3 : NULL, len); assert(rc == 0);
+        if (delay_ms > 0) { pinetime_delay_ms(delay_ms); }
+        entry += 3 + len;
+    }
+    assert(entry == table + size);
     return 0;
 }
 
@@ -282,6 +613,7 @@ static int init_display(void) {
 static int hard_reset(void) {
     hal_gpio_write(DISPLAY_RST, 1);
     hal_gpio_write(DISPLAY_RST, 0);
+    pinetime_delay_us(10);  //  Reset pulse must be at least 10 us
     hal_gpio_write(DISPLAY_RST, 1);
     return 0;
 }
@@ -301,38 +633,84 @@ static int set_orientation(uint8_t orientation) {
     return rc;
 }
 
-/// Transmit ST7789 command
+/// Transmit ST7789 command and its parameters in one transaction
 static int write_command(uint8_t command, const uint8_t *params, uint16_t len) {
-    hal_gpio_write(DISPLAY_DC, 0);
-    int rc = transmit_spi(&command, 1);
-    assert(rc == 0);
-    if (rc == 0 && (params != NULL && len > 0)) {
-        rc = write_data(params, len);
-        assert(rc == 0);
+    const struct spiSegment segments[] = {
+        { 0, &command, 1 },
+        { 1, params, (params != NULL) ? len : 0 },
+    };
+    int rc = transmit_segments(segments, 2); assert(rc == 0);
+    wait_spi();
+    return 0;
+}
+
+/// Transmit the segments with the display selected throughout, switching the data/command pin between segments.
+/// The display stays selected until wait_spi(), so that pixel data can follow in the same transaction.
+static int transmit_segments(const struct spiSegment *segments, int count) {
+    wait_dma();
+    select_display();
+    for (int i = 0; i < count; i++) {
+        if (segments[i].len == 0) { continue; }
+        hal_gpio_write(DISPLAY_DC, segments[i].dc);
+        int rc = transmit_spi(segments[i].data, segments[i].len); assert(rc == 0);
     }
     return 0;
 }
 
-/// Transmit ST7789 data
-static int write_data(const uint8_t *data, uint16_t len) {
+/// Transmit ST7789 data through EasyDMA and return without waiting for the transfer to complete.
+/// data must be in RAM and must not be modified until the next SPI call, or wait_spi().
+static int write_data_async(const uint8_t *data, uint16_t len) {
+    if (len == 0) { return 0; }
+    //  Split the data into equal chunks that fit into one EasyDMA transfer
+    uint16_t count = 1;
+    while (len % count != 0 || len / count > SPIM_DMA_MAX_CHUNK) { count++; }
+    return write_data_dma(data, len / count, count, SPIM_DMA_LIST);
+}
+
+/// Transmit count chunks of ST7789 data through EasyDMA, as a list or by repeating the same chunk (mode is
+/// SPIM_DMA_LIST or SPIM_DMA_REPEAT). Return without waiting for the transfer to complete.
+static int write_data_dma(const uint8_t *data, uint8_t chunk_len, uint16_t count, int mode) {
+    wait_dma();
+    select_display();
     hal_gpio_write(DISPLAY_DC, 1);
-    transmit_spi(data, len);
+    int rc = spim_dma_start(data, chunk_len, count, mode);
+    assert(rc == 0);
+    dma_pending = 1;
     return 0;
 }
 
-/// Write to the SPI port. From https://github.com/lupyuen/pinetime-rust-mynewt/blob/master/rust/mynewt/src/hal.rs
+/// Select the device, unless the current transaction already did
+static void select_display(void) {
+    if (display_selected) { return; }
+    hal_gpio_write(DISPLAY_CS, 0);
+    display_selected = 1;
+}
+
+/// Wait for the data sent by write_data_async(). The device stays selected.
+static void wait_dma(void) {
+    if (!dma_pending) { return; }
+    spim_dma_wait();
+    dma_pending = 0;
+}
+
+/// Wait for the data sent by write_data_async() and de-select the device, ending the transaction.
+/// Must be called before SPI port 0 is handed to another device, like the SPI Flash.
+static void wait_spi(void) {
+    wait_dma();
+    if (!display_selected) { return; }
+    hal_gpio_write(DISPLAY_CS, 1);
+    display_selected = 0;
+}
+
+/// Write to the SPI port. The device must be selected. From https://github.com/lupyuen/pinetime-rust-mynewt/blob/master/rust/mynewt/src/hal.rs
 static int transmit_spi(const uint8_t *data, uint16_t len) {
     if (len == 0) { return 0; }
-    //  Select the device
-    hal_gpio_write(DISPLAY_CS, 0);
     //  Send the data
     int rc = hal_spi_txrx(DISPLAY_SPI,
         (void *) data,  //  TX Buffer
         NULL,  //  RX Buffer (don't receive)
         len);  //  Length
     assert(rc == 0);
-    //  De-select the device
-    hal_gpio_write(DISPLAY_CS, 1);
     return 0;
 }
 
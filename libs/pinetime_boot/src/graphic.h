@@ -1,12 +1,24 @@
 #ifndef __GRAPHIC_H__
 #define __GRAPHIC_H__
 
+#include <stddef.h>
 #include <stdint.h>
+
+/// State of the RLE decoder at the first pixel of a row, generated by tools/rle_encode.py --index
+struct imgRowIndex {
+  uint16_t index;     //  Index of the next run in data
+  uint8_t remaining;  //  Number of pixels left in the current run
+  uint8_t runRow;     //  Row where the current run started
+};
+
 struct imgInfo {
   uint8_t width;
   uint8_t height;
   uint16_t dataSize;
   const uint8_t* data;
+  uint8_t rowIndexStride;  //  Number of rows between two entries of rowIndex, 0 if there is no index
+  const struct imgRowIndex* rowIndex;
+  uint8_t depth;  //  1: runs alternating between background and foreground. 2: 2-bit palette, data starts with the descriptor
 };
 
 static const uint8_t bootLogoRle[] = {
@@ -103,11 +115,45 @@ static const uint8_t bootLogoRle[] = {
         0x71, 0x81, 0x6c, 0x86, 0x6b, 0x84, 0x37,
 };
 
+// Row index, one entry every 8 rows: { run index, pixels left in run, row of run }
+static const struct imgRowIndex bootLogoRleIndex[] = {
+  { 0, 0, 0 },
+  { 17, 113, 7 },
+  { 33, 105, 15 },
+  { 49, 97, 23 },
+  { 65, 97, 31 },
+  { 101, 65, 39 },
+  { 137, 62, 47 },
+  { 171, 59, 55 },
+  { 219, 56, 63 },
+  { 261, 81, 71 },
+  { 277, 64, 79 },
+  { 293, 24, 87 },
+  { 341, 24, 95 },
+  { 389, 24, 103 },
+  { 437, 24, 111 },
+  { 479, 24, 119 },
+  { 513, 24, 127 },
+  { 561, 24, 135 },
+  { 609, 24, 143 },
+  { 657, 24, 151 },
+  { 683, 46, 159 },
+  { 717, 11, 167 },
+  { 765, 14, 175 },
+  { 813, 18, 183 },
+  { 861, 21, 191 },
+  { 903, 25, 199 },
+  { 935, 28, 207 },
+};
+
 struct imgInfo bootLogoInfo = {
   240,
   214,
-  1086,
-  bootLogoRle
+  sizeof(bootLogoRle),
+  bootLogoRle,
+  8,
+  bootLogoRleIndex,
+  1
 };
 
 // /home/jf/nrf52/Pinetime/tools/rle_encode.py  /home/jf/nrf52/pinetime-rust-mynewt/libs/pinetime_boot/src/version-0.0.1.png --c
@@ -140,8 +186,11 @@ static const uint8_t versionRle[] = {
 struct imgInfo versionInfo = {
   88,
   26,
-  295,
-  versionRle
+  sizeof(versionRle),
+  versionRle,
+  0,
+  NULL,
+  1
 };
 
 #endif
\ No newline at end of file
@@ -19,6 +19,7 @@
 //  Render boot graphic and check for manual rollback
 
 #include <os/os.h>
+#include <string.h>
 #include <hal/hal_bsp.h>
 #include <hal/hal_gpio.h>
 #include <hal/hal_system.h>
@@ -29,14 +30,26 @@
 #include "pinetime_boot/pinetime_boot.h"
 #include "pinetime_boot/pinetime_factory.h"
 #include "pinetime_boot/pinetime_delay.h"
+#include "pinetime_boot/pinetime_ticker.h"
+#include "pinetime_boot/pinetime_timing.h"
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/pinetime_log.h"
+#include "pinetime_boot/pinetime_delta.h"
+#include "pinetime_boot/pinetime_slots.h"
 #include <hal/hal_watchdog.h>
 #include "pinetime_boot/version.h"
 
 #define PUSH_BUTTON_IN  13  //  GPIO Pin P0.13: PUSH BUTTON_IN
 #define PUSH_BUTTON_OUT 15  //  GPIO Pin P0.15/TRACEDATA2: PUSH BUTTON_OUT
+#define TICKS_PER_SECOND 64  //  Button samples per second while waiting for the button
+#define WAIT_TICKS (TICKS_PER_SECOND * 5)  //  Full wait for the button: 5 seconds
+#define INSTALL_ATTEMPTS 3  //  Installs that fail to verify are retried after a reset, up to this many attempts
 
-/// Vector Table will be relocated here.
-#define RELOCATED_VECTOR_TABLE 0x7F00
+/// Vector Table will be relocated to a 256-byte slot of this page (FLASH_AREA_VECTOR_TABLES in bsp.yml). VTOR needs
+/// the table to be aligned to a power of 2 larger than the table.
+#define VECTOR_TABLE_PAGE 0x7F000
+#define VECTOR_TABLE_PAGE_SIZE 0x1000
+#define VECTOR_TABLE_SLOT_SIZE 0x100
 
 /// Number of entries in the Vector Table.
 #define NVIC_NUM_VECTORS (16 + 38)
@@ -45,10 +58,15 @@
 #define SCB_VTOR ((uint32_t *) 0xE000ED08)
 
 void blink_backlight(int pattern_id, int repetitions);  //  Defined in blink.c
-static void relocate_vector_table(void *vector_table, void *relocated_vector_table);
+static void relocate_vector_table(void *vector_table);
+
+/// Image header of the primary slot before MCUBoot ran, compared with the header of the image it starts
+static struct image_header primary_header;
 
 /// Init the display and render the boot graphic. Called by sysinit() during startup, defined in pkg.yml.
 void pinetime_boot_init(void) {
+    pinetime_info_init();
+    pinetime_timing_start();
     console_printf("Starting Bootloader...\n");  console_flush();
     pinetime_set_version();
 
@@ -64,52 +82,152 @@ void pinetime_boot_init(void) {
 
     // Display version image
     pinetime_version_image();
-
-    //  Wait 5 seconds for button press.
-    uint32_t button_samples = 0;
-    console_printf("Waiting 5 seconds for button...\n");  console_flush();
-    for (int i = 0; i < 64 * 5; i++) {
-        for (int delay = 0; delay < 3000; delay++) {
-            button_samples += hal_gpio_read(PUSH_BUTTON_IN);
+    pinetime_timing_mark(PINETIME_PHASE_VERSION);
+
+    //  Wait 5 seconds for button press. The button is sampled once per tick, the CPU sleeps in between.
+    //  With fast boot, wait only for the grace window unless the button is pressed: now (the display init gave the
+    //  button pin time to settle) or during the grace window.
+    int wait_ticks = WAIT_TICKS;
+    if (MYNEWT_VAL(PINETIME_BOOT_FAST_BOOT) && !hal_gpio_read(PUSH_BUTTON_IN)) {
+        wait_ticks = MYNEWT_VAL(PINETIME_BOOT_FAST_BOOT_GRACE_MS) * TICKS_PER_SECOND / 1000;
+        if (wait_ticks > WAIT_TICKS) { wait_ticks = WAIT_TICKS; }
+    }
+    //  A direct recovery install interrupted by a reset left the primary slot partly written: resume it after the wait.
+    int last_action = pinetime_log_last_action();
+    int resume_install = MYNEWT_VAL(PINETIME_BOOT_DIRECT_RECOVERY) &&
+        (last_action == PINETIME_ACTION_INSTALL_STARTED || last_action == PINETIME_ACTION_INSTALL_UNVERIFIED);
+    uint32_t button_ticks = 0;  //  Number of ticks with the button pressed
+    console_printf("Waiting %d ticks for button...\n", wait_ticks);  console_flush();
+    pinetime_ticker_start(TICKS_PER_SECOND);
+    int i = 0;
+    while (i < wait_ticks) {
+        //  Ticks missed while the CPU was busy (drawing, console) count too: the window and the hold time are real time
+        int first = i;
+        uint32_t ticks = pinetime_ticker_wait();
+        i += ticks;
+        if (hal_gpio_read(PUSH_BUTTON_IN)) {
+            button_ticks += ticks;
+            wait_ticks = WAIT_TICKS;  //  Button pressed during the grace window: wait for the full hold time
         }
-        if(i % 64 == 0) {
-          console_printf("step %d - %d\n", (i / (64)) + 1, (int)button_samples); console_flush();
+        //  Step once per second and redraw once per 8 ticks, for the last such tick in the window since first
+        int last = ((i < wait_ticks) ? i : wait_ticks) - 1;
+        int second = last / TICKS_PER_SECOND * TICKS_PER_SECOND;
+        if(second >= first) {
+          console_printf("step %d - %d\n", (second / TICKS_PER_SECOND) + 1, (int)button_ticks); console_flush();
           hal_watchdog_tickle();
         }
 
-        if(i % 8 == 0) {
+        int step = last / 8 * 8;
+        if(step >= first) {
           uint16_t color = RED;
-          if (button_samples < 3000 * 64 * 2) {
+          if (button_ticks < TICKS_PER_SECOND * 2) {
             color = GREEN;
-          } else if (button_samples < 3000 * 64 * 4) {
+          } else if (button_ticks < TICKS_PER_SECOND * 4) {
             color = BLUE;
           } else {
             color = RED;
           }
 
-          pinetime_boot_display_image_colors(WHITE, color, 240 - ((i / 8) * 6) + 1);
+          pinetime_boot_update_image_colors(WHITE, color, 240 - ((step / 8) * 6) + 1);
         }
     }
-    console_printf("Waited 5 seconds (%d)\n", (int)button_samples);  console_flush();
-
-    //  Check whether button is pressed and held. Sample count must high enough to avoid accidental rollbacks.
-    if(button_samples > (3000 * 64 * 4)) {
+    pinetime_ticker_stop();
+    pinetime_timing_mark(PINETIME_PHASE_WAIT);
+    pinetime_timing_wait_ms(i * 1000 / TICKS_PER_SECOND);  //  Ticks counted by TIMER4, including the missed ones
+    pinetime_info.button_ms = button_ticks * 1000 / TICKS_PER_SECOND;
+    console_printf("Waited %d ticks (%d)\n", i, (int)button_ticks);  console_flush();
+
+    //  Check whether button is pressed and held. Hold time must be long enough to avoid accidental rollbacks.
+    //  While resuming a direct install, holding the button for 4 seconds restores the recovery firmware through the
+    //  secondary slot instead.
+    int hold_recovery = button_ticks > (TICKS_PER_SECOND * 4);
+    int direct_install = resume_install ? !hold_recovery :
+        (MYNEWT_VAL(PINETIME_BOOT_DIRECT_RECOVERY) && hold_recovery);
+    //  A pending compressed update is installed over the primary slot, and may already be partly installed: don't
+    //  swap the slots to revert, MCUBoot would reject the compressed image and start the primary slot.
+    int swap_type = boot_swap_type();
+    int update_pending = MYNEWT_VAL(PINETIME_BOOT_COMPRESSED_UPDATE) &&
+        (swap_type == BOOT_SWAP_TYPE_TEST || swap_type == BOOT_SWAP_TYPE_PERM) && has_compressed_update();
+    int swap = !direct_install && button_ticks > (TICKS_PER_SECOND * 2) &&  //  Restart for MCUBoot to swap the slots
+        (hold_recovery || !update_pending);
+    if (direct_install) {
+      //  Install the recovery firmware in the primary slot: MCUBoot will have nothing to swap
+      console_printf("Installing factory firmware\n");  console_flush();
+      pinetime_info.action = PINETIME_ACTION_INSTALL;
+      int rc = install_factory();
+      if (rc == -2 && pinetime_log_failures(PINETIME_ACTION_INSTALL_UNVERIFIED, PINETIME_ACTION_INSTALL_STARTED) <
+          INSTALL_ATTEMPTS) {
+        //  The primary slot is partly written and the boot log still says so: restart to resume the install. Attempts
+        //  cut short by a reset or a power loss don't count, only the ones that failed to verify.
+        pinetime_info_seal();
+        hal_system_reset();
+      }
+      if (rc != 0) {
+        //  End the install in the boot log, so that the next boot doesn't resume it and waits for the button
+        console_printf("Factory firmware not installed (%d)\n", rc);  console_flush();
+        pinetime_info.action = PINETIME_ACTION_INSTALL_FAILED;
+        pinetime_log_append();
+      }
+    } else if(hold_recovery) {
       console_printf("Restoring factory firmware\n");  console_flush();
-      restore_factory();
+      pinetime_info.action = PINETIME_ACTION_RECOVERY;
+      int rewritten = restore_factory();
+      console_printf("Rewrote %d sectors\n", rewritten);  console_flush();
+      if (rewritten < 0) {
+        //  Don't swap a bad recovery firmware in: keep running the current firmware
+        pinetime_info.action = PINETIME_ACTION_RUN;
+        swap = 0;
+      }
     }
 
-    if(button_samples > (3000 * 64 * 2)) {
+    if(swap) {
         console_printf("Flashing secondary firmware into primary\n");  console_flush();
 
         //  Mark the previous firmware for rollback and blink slowly 4 times.
+        if (pinetime_info.action == PINETIME_ACTION_RUN) { pinetime_info.action = PINETIME_ACTION_REVERT; }
         boot_set_pending(0);
         blink_backlight(2, 4);
 
         //  Restart for MCUBoot to rollback the firmware.
+        pinetime_info.requested_swap_type = boot_swap_type();
+        pinetime_log_append();
+        pinetime_info_seal();
         hal_system_reset();
         return;
     } else {
       console_printf("MCUBoot processing...\n");  console_flush();
+      pinetime_info.requested_swap_type = boot_swap_type();
+      int rc = hal_flash_read(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET,
+          &primary_header, sizeof(primary_header));
+      assert(rc == 0);
+
+      //  Rebuild a delta image in the secondary slot into the full image that MCUBoot will check and swap in
+      if (MYNEWT_VAL(PINETIME_BOOT_DELTA_UPDATE) &&
+          (pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_TEST ||
+           pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_PERM)) {
+        rc = pinetime_delta_apply();
+        console_printf("Delta image: %d\n", rc);  console_flush();
+      }
+
+      //  Decompress a compressed image in the secondary slot over the primary slot: MCUBoot will have nothing to swap
+      if (MYNEWT_VAL(PINETIME_BOOT_COMPRESSED_UPDATE) &&
+          (pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_TEST ||
+           pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_PERM)) {
+        rc = install_compressed_update();
+        console_printf("Compressed image: %d\n", rc);  console_flush();
+        if (rc == -2 && pinetime_log_failures(PINETIME_ACTION_UPDATE_UNVERIFIED, PINETIME_ACTION_UPDATE_STARTED) <
+            INSTALL_ATTEMPTS) {
+          //  The swap is still pending: restart to resume the install. As for the direct install, only the attempts
+          //  that failed to verify count.
+          pinetime_info_seal();
+          hal_system_reset();
+        }
+        if (rc == -2) {
+          //  Give up: MCUBoot rejects the compressed image and erases the secondary slot
+          pinetime_info.action = PINETIME_ACTION_INSTALL_FAILED;
+          pinetime_log_append();
+        }
+      }
     }
 }
 
@@ -140,6 +258,7 @@ void boot_custom_start(
     uintptr_t flash_base,
     struct boot_rsp *rsp
 ) {
+    pinetime_timing_mark(PINETIME_PHASE_MCUBOOT);
     //  blink_backlight(2, 2);
     console_printf("Bootloader done\n");  console_flush();
 
@@ -153,49 +272,68 @@ void boot_custom_start(
     );                               //  Equals 0x8020 (__isr_vector)
     //  console_printf("vector_table=%lx, flash_base=%lx, image_off=%lx, hdr_size=%lx\n", (uint32_t) vector_table, (uint32_t) flash_base, (uint32_t) rsp->br_image_off, (uint32_t) rsp->br_hdr->ih_hdr_size); console_flush();
 
-    //  Relocate the application vector table to a 0x100 page boundary in ROM.
-    relocate_vector_table(  //  Relocate the vector table...
-        vector_table,       //  From the non-aligned application address (0x8020)
-        (void *) RELOCATED_VECTOR_TABLE  //  To the relocated address aligned to 0x100 page boundary
-    );
+    //  Relocate the application vector table from the non-aligned application address (0x8020) to a 0x100 boundary in ROM.
+    relocate_vector_table(vector_table);
+    pinetime_timing_mark(PINETIME_PHASE_VECTOR_TABLE);
     //  blink_backlight(3, 4);
 
     setup_watchdog();
+    pinetime_timing_mark(PINETIME_PHASE_START);
+    pinetime_timing_report();
+    //  A swap, or a compressed update installed by the bootloader, changes the image header of the primary slot
+    if (pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_TEST ||
+        pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_PERM ||
+        pinetime_info.requested_swap_type == BOOT_SWAP_TYPE_REVERT) {
+        pinetime_info.swap_outcome = memcmp(&primary_header, rsp->br_hdr, sizeof(primary_header)) ?
+            PINETIME_SWAP_DONE : PINETIME_SWAP_REJECTED;
+    }
+    pinetime_log_append();
+    pinetime_info_seal();
     
     //  Start the Active Firmware Image at the Reset_Handler function.
     hal_system_start(vector_table);
 }
 
-/// Relocate the Arm Vector Table from vector_table to relocated_vector_table.
-/// relocated_vector_table must be aligned to 0x100 page boundary.
-static void relocate_vector_table(void *vector_table, void *relocated_vector_table) {
-    uint32_t *current_location = (uint32_t *) vector_table;
-    uint32_t *new_location = (uint32_t *) relocated_vector_table;
-    if (new_location == current_location) { return; }  //  No need to relocate
-    //  Check whether we need to copy the vectors.
-    int vector_diff = 0;  //  Non-zero if a vector is different
-    for (int i = 0; i < NVIC_NUM_VECTORS; i++) {
-        if (new_location[i] != current_location[i]) {
-            vector_diff = 1;
+/// Relocate the Arm Vector Table from vector_table to a slot of the vector table page, and point VTOR to it.
+/// The slots are filled in order. The slot that already holds the same vectors is reused, otherwise the vectors are
+/// written to the first empty slot, and the page is only erased when all slots are used.
+static void relocate_vector_table(void *vector_table) {
+    const uint32_t *current_location = (const uint32_t *) vector_table;
+    uint32_t *new_location = NULL;
+    int found = 0;  //  Non-zero if a slot already holds the vectors
+    for (uint32_t slot = VECTOR_TABLE_PAGE; slot < VECTOR_TABLE_PAGE + VECTOR_TABLE_PAGE_SIZE; slot += VECTOR_TABLE_SLOT_SIZE) {
+        uint32_t *candidate = (uint32_t *) slot;
+        if (candidate[0] == 0xffffffff) {  //  Empty slot: the initial stack pointer is never erased flash
+            new_location = candidate;
+            break;
+        }
+        if (memcmp(candidate, current_location, NVIC_NUM_VECTORS * sizeof(uint32_t)) == 0) {
+            new_location = candidate;
+            found = 1;
             break;
         }
     }
-    //  If we need to copy the vectors, erase the flash ROM and write the vectors.
-    if (vector_diff) {
-        hal_flash_erase(  //  Erase...
-            0,            //  Internal Flash ROM
-            (uint32_t) relocated_vector_table,  //  At the relocated address
-            0x100         //  Assume that we erase an entire page
-        );
+    //  If we need to copy the vectors, write them to the empty slot. Erase the page if there is none.
+    if (!found) {
+        if (new_location == NULL) {
+            hal_flash_erase(  //  Erase...
+                0,            //  Internal Flash ROM
+                VECTOR_TABLE_PAGE,  //  The whole vector table page
+                VECTOR_TABLE_PAGE_SIZE
+            );
+            pinetime_info_flash_erase(1);
+            new_location = (uint32_t *) VECTOR_TABLE_PAGE;
+        }
         hal_flash_write(  //  Write...
             0,            //  Internal Flash ROM
-            (uint32_t) relocated_vector_table,  //  To the relocated address
+            (uint32_t) new_location,  //  To the slot
             vector_table, //  From the original address
-            0x100         //  Assume that we copy an entire page
+            NVIC_NUM_VECTORS * sizeof(uint32_t)
         );
+        pinetime_info_flash_write(NVIC_NUM_VECTORS * sizeof(uint32_t));
     }
     //  Point VTOR Register in the System Control Block to the relocated vector table.
-    *SCB_VTOR = (uint32_t) relocated_vector_table;
+    *SCB_VTOR = (uint32_t) new_location;
 }
 
 /// Blink 4 times and reboot
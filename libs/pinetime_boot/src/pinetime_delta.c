@@ -0,0 +1,216 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Delta images: rebuild a full MCUBoot image in the secondary slot from the primary slot and a stream of COPY and
+//  INSERT operations, so that an OTA update only needs to transfer what changed. The stream is first moved ("stashed")
+//  to the end of the secondary slot, then the new image is written from the start of the slot, one batch at a time.
+//  MCUBoot then checks and swaps the rebuilt image as usual, and can revert it.
+#include <os/os.h>
+#include <string.h>
+#include <hal/hal_flash.h>
+#include <hal/hal_watchdog.h>
+#include "pinetime_boot/pinetime_delta.h"
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/pinetime_sha256.h"
+#include "pinetime_boot/pinetime_slots.h"
+
+/// The stash ends before the trailer of the secondary slot, with the header last: the header is only written once the
+/// stream is complete, and its fixed position lets an interrupted rebuild find the stash again.
+#define STASH_HEADER \
+  (PINETIME_SECONDARY_OFFSET + PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE - sizeof(struct pinetime_delta_header))
+
+static uint8_t in_buffer[PINETIME_BATCH_SIZE];   //  Stream and primary slot data
+static uint8_t out_buffer[PINETIME_BATCH_SIZE];  //  Next batch of the new image
+
+static int read_header(uint32_t address, struct pinetime_delta_header *header);
+static int check_source(const struct pinetime_delta_header *header);
+static int stash_delta(const struct pinetime_delta_header *header);
+static int rebuild_image(const struct pinetime_delta_header *header);
+static void erase_range(uint32_t start, uint32_t end);
+
+int pinetime_delta_apply(void) {
+  struct pinetime_delta_header header;
+  int rc;
+  //  A complete stash means that the rebuild was interrupted: the start of the slot may be overwritten already
+  if (read_header(STASH_HEADER, &header) != 0) {
+    if (read_header(PINETIME_SECONDARY_OFFSET, &header) != 0) { return 0; }  //  No delta image
+    if (check_source(&header) != 0) { return -1; }
+    rc = stash_delta(&header);
+    if (rc != 0) { return rc; }
+  } else if (check_source(&header) != 0) {
+    return -1;
+  }
+  rc = rebuild_image(&header);
+
+  //  Drop the stash, header first
+  erase_range(STASH_HEADER - header.delta_size, STASH_HEADER + sizeof(header));
+  return (rc == 0) ? 1 : -1;
+}
+
+/// Read the delta header at the flash address of the secondary slot. Return 0 if it is valid and fits in the slot:
+/// the new image and the stream at the start of the slot must not overlap the stash.
+static int read_header(uint32_t address, struct pinetime_delta_header *header) {
+  int rc = hal_flash_read(PINETIME_SECONDARY_DEVICE, address, header, sizeof(*header));
+  assert(rc == 0);
+  if (header->magic != PINETIME_DELTA_MAGIC ||
+      header->crc != pinetime_crc32(header, offsetof(struct pinetime_delta_header, crc))) { return -1; }
+  if (header->size > PINETIME_SLOT_SIZE || header->source_size > PINETIME_SLOT_SIZE ||
+      header->delta_size > PINETIME_SLOT_SIZE) { return -1; }
+  uint32_t stash_start = (STASH_HEADER - header->delta_size) / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE;
+  uint32_t image_end = (header->size + PINETIME_SECTOR_SIZE - 1) / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE;
+  if (stash_start < PINETIME_SECONDARY_OFFSET + sizeof(*header) + header->delta_size ||
+      stash_start < PINETIME_SECONDARY_OFFSET + image_end) { return -1; }
+  return 0;
+}
+
+/// Return 0 if the primary slot holds the image that the delta applies to
+static int check_source(const struct pinetime_delta_header *header) {
+  struct pinetime_sha256 sha;
+  uint8_t digest[PINETIME_SHA256_SIZE];
+  pinetime_sha256_init(&sha);
+  for (uint32_t offset = 0; offset < header->source_size; offset += PINETIME_BATCH_SIZE) {
+    uint32_t len = header->source_size - offset;
+    if (len > PINETIME_BATCH_SIZE) { len = PINETIME_BATCH_SIZE; }
+    if (offset % PINETIME_SECTOR_SIZE == 0) { hal_watchdog_tickle(); }
+    int rc = hal_flash_read(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET + offset, in_buffer, len);
+    assert(rc == 0);
+    pinetime_sha256_update(&sha, in_buffer, len);
+  }
+  pinetime_sha256_final(&sha, digest);
+  return (memcmp(digest, header->source_sha256, PINETIME_SHA256_SIZE) == 0) ? 0 : -1;
+}
+
+/// Copy the stream from the start of the secondary slot to the stash, then write the header. Return 0 if the stream
+/// matches its SHA-256.
+static int stash_delta(const struct pinetime_delta_header *header) {
+  int rc;
+  uint32_t stream = STASH_HEADER - header->delta_size;
+  struct pinetime_sha256 sha;
+  uint8_t digest[PINETIME_SHA256_SIZE];
+  erase_range(stream, STASH_HEADER + sizeof(*header));
+  pinetime_sha256_init(&sha);
+  for (uint32_t offset = 0; offset < header->delta_size; offset += PINETIME_BATCH_SIZE) {
+    uint32_t len = header->delta_size - offset;
+    if (len > PINETIME_BATCH_SIZE) { len = PINETIME_BATCH_SIZE; }
+    if (offset % PINETIME_SECTOR_SIZE == 0) { hal_watchdog_tickle(); }
+    uint32_t source = PINETIME_SECONDARY_OFFSET + sizeof(*header) + offset;
+    rc = hal_flash_read(PINETIME_SECONDARY_DEVICE, source, in_buffer, len);
+    assert(rc == 0);
+    pinetime_sha256_update(&sha, in_buffer, len);
+    rc = hal_flash_write(PINETIME_SECONDARY_DEVICE, stream + offset, in_buffer, len);
+    assert(rc == 0);
+    pinetime_info_flash_write(len);
+  }
+  pinetime_sha256_final(&sha, digest);
+  if (memcmp(digest, header->delta_sha256, PINETIME_SHA256_SIZE) != 0) { return -1; }
+  rc = hal_flash_write(PINETIME_SECONDARY_DEVICE, STASH_HEADER, header, sizeof(*header));
+  assert(rc == 0);
+  pinetime_info_flash_write(sizeof(*header));
+  return 0;
+}
+
+//  Position in the stashed stream and in the new image
+static uint32_t stream_offset, stream_end;
+static uint32_t out_offset, out_used;
+
+/// Read len bytes of the stashed stream. Return 0, or -1 past its end.
+static int read_stream(void *buf, uint32_t len) {
+  if (stream_end - stream_offset < len) { return -1; }
+  int rc = hal_flash_read(PINETIME_SECONDARY_DEVICE, stream_offset, buf, len);
+  assert(rc == 0);
+  stream_offset += len;
+  return 0;
+}
+
+/// Write the batch of the new image, erasing each sector before its first batch
+static void flush_output(void) {
+  int rc;
+  if (out_used == 0) { return; }
+  if (out_offset % PINETIME_SECTOR_SIZE == 0) {
+    hal_watchdog_tickle();
+    rc = hal_flash_erase_sector(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + out_offset);
+    assert(rc == 0);
+    pinetime_info_flash_erase(1);
+  }
+  rc = hal_flash_write(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + out_offset, out_buffer, out_used);
+  assert(rc == 0);
+  pinetime_info_flash_write(out_used);
+  out_offset += out_used;
+  out_used = 0;
+}
+
+/// Append len bytes to the new image
+static void write_output(const uint8_t *data, uint32_t len) {
+  while (len > 0) {
+    uint32_t n = (PINETIME_BATCH_SIZE - out_used < len) ? PINETIME_BATCH_SIZE - out_used : len;
+    memcpy(out_buffer + out_used, data, n);
+    out_used += n;
+    data += n;
+    len -= n;
+    if (out_used == PINETIME_BATCH_SIZE) { flush_output(); }
+  }
+}
+
+/// Run the stashed stream to write the new image at the start of the secondary slot. Return 0 if the stream produces
+/// exactly the size of the new image.
+static int rebuild_image(const struct pinetime_delta_header *header) {
+  stream_offset = STASH_HEADER - header->delta_size;
+  stream_end = STASH_HEADER;
+  out_offset = 0;
+  out_used = 0;
+  while (stream_offset < stream_end) {
+    uint8_t op;
+    uint32_t args[2];
+    if (read_stream(&op, 1) != 0) { return -1; }
+    if (op == PINETIME_DELTA_COPY) {
+      if (read_stream(args, 8) != 0) { return -1; }
+      if (args[0] > header->source_size || args[1] > header->source_size - args[0]) { return -1; }
+      for (uint32_t i = 0; i < args[1]; i += PINETIME_BATCH_SIZE) {
+        uint32_t len = (args[1] - i < PINETIME_BATCH_SIZE) ? args[1] - i : PINETIME_BATCH_SIZE;
+        if (out_offset + out_used + len > header->size) { return -1; }
+        int rc = hal_flash_read(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET + args[0] + i, in_buffer, len);
+        assert(rc == 0);
+        write_output(in_buffer, len);
+      }
+    } else if (op == PINETIME_DELTA_INSERT) {
+      if (read_stream(args, 4) != 0) { return -1; }
+      for (uint32_t i = 0; i < args[0]; i += PINETIME_BATCH_SIZE) {
+        uint32_t len = (args[0] - i < PINETIME_BATCH_SIZE) ? args[0] - i : PINETIME_BATCH_SIZE;
+        if (out_offset + out_used + len > header->size) { return -1; }
+        if (read_stream(in_buffer, len) != 0) { return -1; }
+        write_output(in_buffer, len);
+      }
+    } else {
+      return -1;
+    }
+  }
+  flush_output();
+  return (out_offset == header->size) ? 0 : -1;
+}
+
+/// Erase the sectors of the secondary slot that overlap [start, end), last sector first
+static void erase_range(uint32_t start, uint32_t end) {
+  uint32_t first = start / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE;
+  for (uint32_t sector = (end - 1) / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE; ; sector -= PINETIME_SECTOR_SIZE) {
+    hal_watchdog_tickle();
+    int rc = hal_flash_erase_sector(PINETIME_SECONDARY_DEVICE, sector);
+    assert(rc == 0);
+    pinetime_info_flash_erase(1);
+    if (sector == first) { break; }
+  }
+}
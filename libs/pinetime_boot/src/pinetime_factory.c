@@ -1,32 +1,423 @@
 #include "pinetime_boot/pinetime_factory.h"
+#include <string.h>
 #include <hal/hal_flash.h>
 #include "os/mynewt.h"
 #include <hal/hal_watchdog.h>
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/pinetime_log.h"
+#include "pinetime_boot/pinetime_sha256.h"
+#include "pinetime_boot/pinetime_heatshrink.h"
+#include "pinetime_boot/pinetime_slots.h"
+#include "bootutil/image.h"
 
-//  Flash Device for Image
-#define FLASH_DEVICE 1  //  0 for Internal Flash ROM, 1 for External SPI Flash
+/// Buffers for reading flash: source and destination
+static uint8_t flash_buffer[PINETIME_BATCH_SIZE];
+static uint8_t compare_buffer[PINETIME_BATCH_SIZE];
 
-/// Buffer for reading flash and writing to display
-#define BATCH_SIZE  256  //  Max number of SPI data bytes to be transmitted
-static uint8_t flash_buffer[BATCH_SIZE];
+//  hal_flash_erase() sends a 64 KB block erase of the SPI Flash for a 64 KB aligned range
+#define BLOCK_SIZE  0x10000
+#define ROUND_TO_SECTOR(size) (((size) + PINETIME_SECTOR_SIZE - 1) / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE)
+//  Typical time to program a whole sector (us)
+#define SECTOR_PROGRAM_TIME ((PINETIME_SECTOR_SIZE / MYNEWT_VAL(SPIFLASH_PAGE_SIZE)) * MYNEWT_VAL(SPIFLASH_TPP_TYPICAL))
 
-#define FACTORY_SIZE 0x40000
-#define FACTORY_OFFSET_SOURCE 0
-#define FACTORY_OFFSET_DESTINATION 0x40000
+/// State of a destination sector, compared with the source sector
+enum sector_state {
+  SECTOR_SAME,   //  Same content: nothing to do
+  SECTOR_BLANK,  //  Erased: program only
+  SECTOR_DIFF,   //  Different: erase and program
+};
 
+/// Header of a compressed image (tools/factory_pack.py), followed by the heatshrink stream
+struct packed_header {
+  uint32_t magic;          //  PACKED_MAGIC
+  uint8_t window_sz2;      //  Must be PINETIME_HEATSHRINK_WINDOW_SZ2
+  uint8_t lookahead_sz2;   //  Must be PINETIME_HEATSHRINK_LOOKAHEAD_SZ2
+  uint16_t reserved;
+  uint32_t size;           //  Size of the MCUBoot image, decompressed
+  uint32_t packed_size;    //  Size of the heatshrink stream
+};
+#define PACKED_MAGIC 0x315a5450  //  "PTZ1"
 
-void restore_factory(void) {
+/// Field of the TLV area that image_check waits for
+enum check_field {
+  FIELD_INFO,    //  struct image_tlv_info at hashed
+  FIELD_TLV,     //  struct image_tlv
+  FIELD_SHA256,  //  Value of the SHA-256 TLV
+  FIELD_DONE,    //  SHA-256 TLV found, or the TLV area is not valid
+};
+
+/// SHA-256 check of the source image, fed with the source bytes as they are compared: the image is hashed and its
+/// TLVs are parsed on the way, so that a compressed image is decompressed only once to check it
+struct image_check {
+  struct pinetime_sha256 sha;  //  Hash of the bytes before hashed
+  uint32_t hashed;             //  Size of the header, image and protected TLVs: offset of the TLV info
+  uint32_t end;                //  End of the TLVs, set from the TLV info
+  uint32_t field;              //  Offset of the field waited for
+  uint32_t field_len;          //  Size of the field
+  uint32_t field_read;         //  Number of bytes of the field read so far
+  enum check_field field_type;
+  int found;                   //  Non-zero if value holds the SHA-256 TLV
+  uint8_t value[PINETIME_SHA256_SIZE];  //  Field read so far
+};
+
+//  Source image: recovery image or update in the secondary slot, plain MCUBoot image or compressed image
+//  decompressed on the fly
+static int source_device;         //  Flash device of the source image
+static uint32_t source_offset;    //  Offset of the source image
+static int source_packed;         //  Non-zero if the source image is compressed
+static uint32_t source_size;      //  Size of the source image, decompressed
+static uint32_t source_position;  //  Offset of the next byte out of source_decoder
+static struct pinetime_heatshrink source_decoder;
+static uint32_t sector_position;  //  Offset of the last sector read, and the decoder state there
+static struct pinetime_heatshrink sector_decoder;
+
+/// State of each destination sector, set by scan_image()
+static uint8_t sector_states[(PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE) / PINETIME_SECTOR_SIZE];
+
+static void open_source(int device, uint32_t offset, uint32_t area_size);
+static void read_source(uint32_t offset, void *buf, uint32_t len);
+static int scan_image(int device, uint32_t destination, uint32_t *size);
+static void erase_trailer(int device, uint32_t slot);
+static enum sector_state compare_sector(int device, uint32_t destination, uint32_t offset,
+  struct image_check *check);
+static void check_source(struct image_check *check, uint32_t offset, const uint8_t *buf, uint32_t len);
+static int copy_sector(int device, uint32_t destination, uint32_t offset);
+static int copy_to_primary(uint32_t size);
+
+int restore_factory(void) {
   int rc;
-  for (uint32_t erased = 0; erased < FACTORY_SIZE; erased += 0x1000) {
-    rc = hal_flash_erase_sector(FLASH_DEVICE, FACTORY_OFFSET_DESTINATION + erased);
+  int rewritten = 0;
+  uint32_t size;
+  open_source(PINETIME_RECOVERY_DEVICE, PINETIME_RECOVERY_OFFSET, PINETIME_RECOVERY_SIZE);
+  if (scan_image(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, &size) != 0) { return -1; }
+  for (uint32_t block = 0; block < size; ) {
+    uint32_t block_end = (block / BLOCK_SIZE + 1) * BLOCK_SIZE;
+    if (block_end > size) { block_end = size; }
+
+    //  Bit i is set if sector i of the block must be erased / programmed
+    uint16_t erase = 0, program = 0;
+    uint32_t erase_count = 0, same_count = 0;
+    for (uint32_t sector = block; sector < block_end; sector += PINETIME_SECTOR_SIZE) {
+      uint16_t bit = 1 << ((sector - block) / PINETIME_SECTOR_SIZE);
+      switch (sector_states[sector / PINETIME_SECTOR_SIZE]) {
+        case SECTOR_SAME:  same_count++; break;
+        case SECTOR_BLANK: program |= bit; break;
+        case SECTOR_DIFF:  erase |= bit; program |= bit; erase_count++; break;
+      }
+    }
+
+    //  Erase the block at once if erasing its sectors one by one would take longer, even after programming the
+    //  sectors that were the same (TBE2 vs TSE).
+    if (erase_count > 0 && block_end - block == BLOCK_SIZE &&
+        erase_count * MYNEWT_VAL(SPIFLASH_TSE_TYPICAL) >= MYNEWT_VAL(SPIFLASH_TBE2_TYPICAL) + same_count * SECTOR_PROGRAM_TIME) {
+      rc = hal_flash_erase(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + block, BLOCK_SIZE);
+      assert(rc == 0);
+      pinetime_info_flash_erase(BLOCK_SIZE / PINETIME_SECTOR_SIZE);
+      erase = 0;
+      program = 0xffff;
+    }
+
+    for (uint32_t sector = block; sector < block_end; sector += PINETIME_SECTOR_SIZE) {
+      uint16_t bit = 1 << ((sector - block) / PINETIME_SECTOR_SIZE);
+      hal_watchdog_tickle();
+      if (erase & bit) {
+        rc = hal_flash_erase_sector(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + sector);
+        assert(rc == 0);
+        pinetime_info_flash_erase(1);
+      }
+      if (program & bit) {
+        if (copy_sector(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, sector) != 0) { return -2; }
+        rewritten++;
+      }
+    }
+    block = block_end;
+  }
+  return rewritten;
+}
+
+int install_factory(void) {
+  uint32_t size;
+  open_source(PINETIME_RECOVERY_DEVICE, PINETIME_RECOVERY_OFFSET, PINETIME_RECOVERY_SIZE);
+  if (scan_image(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, &size) != 0) { return -1; }
+
+  //  Mark the attempt in the boot log: the install is resumed at the next boot until it is marked as done
+  uint8_t action = pinetime_info.action;
+  pinetime_info.action = PINETIME_ACTION_INSTALL_STARTED;
+  pinetime_log_append();
+  pinetime_info.action = action;
+
+  //  Drop the MCUBoot trailers so that nothing is swapped or reverted over the new firmware
+  erase_trailer(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  erase_trailer(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+
+  if (copy_to_primary(size) != 0) {
+    //  Tell a failed read-back from an attempt cut short by a reset: only the failures count against the retries
+    pinetime_info.action = PINETIME_ACTION_INSTALL_UNVERIFIED;
+    pinetime_log_append();
+    pinetime_info.action = action;
+    return -2;
+  }
+
+  //  Mark the install as done
+  pinetime_info.action = PINETIME_ACTION_INSTALL;
+  pinetime_log_append();
+  return 0;
+}
+
+int install_compressed_update(void) {
+  uint32_t size;
+  open_source(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE);
+  if (!source_packed) { return 0; }  //  Plain image: MCUBoot swaps it
+  if (scan_image(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, &size) != 0) { return -1; }
+
+  //  Count the attempt in the boot log
+  uint8_t action = pinetime_info.action;
+  pinetime_info.action = PINETIME_ACTION_UPDATE_STARTED;
+  pinetime_log_append();
+  pinetime_info.action = action;
+
+  //  The pending swap in the secondary trailer marks the install as unfinished until the end: a reset on the way
+  //  comes back here. The primary trailer goes first, it belongs to the firmware being overwritten.
+  erase_trailer(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  if (copy_to_primary(size) != 0) {
+    //  Same as install_factory(): only the failed read-backs count against the retries
+    pinetime_info.action = PINETIME_ACTION_UPDATE_UNVERIFIED;
+    pinetime_log_append();
+    pinetime_info.action = action;
+    return -2;
+  }
+  erase_trailer(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  return 1;
+}
+
+int has_compressed_update(void) {
+  open_source(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE);
+  return source_packed;
+}
+
+/// Copy the sectors of the source image that differ from the primary slot, as set by scan_image(). When resuming an
+/// install, the sectors already copied are the same and are skipped. Return 0 if done, -1 if a write failed.
+static int copy_to_primary(uint32_t size) {
+  int rc;
+  for (uint32_t sector = 0; sector < size; sector += PINETIME_SECTOR_SIZE) {
     hal_watchdog_tickle();
+    switch (sector_states[sector / PINETIME_SECTOR_SIZE]) {
+      case SECTOR_SAME:
+        break;
+      case SECTOR_DIFF:
+        rc = hal_flash_erase_sector(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET + sector);
+        assert(rc == 0);
+        pinetime_info_flash_erase(1);
+        //  Fall through
+      case SECTOR_BLANK:
+        if (copy_sector(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, sector) != 0) { return -1; }
+        break;
+    }
+  }
+  return 0;
+}
+
+/// Compare the source image with the sectors at destination of the device and set sector_states. The SHA-256 TLV
+/// of the image is checked on the way against its header, image and protected TLVs, like MCUBoot does. A plain image
+/// is compared up to the end of its TLVs. A compressed image is decompressed once, up to the size in its packed
+/// header, and its TLVs are found in the same pass. Return 0 and the size of the image (TLVs included) rounded up to
+/// the sector size, or -1 if the image is not valid.
+static int scan_image(int device, uint32_t destination, uint32_t *size) {
+  struct image_header header;
+  read_source(0, &header, sizeof(header));
+  if (header.ih_magic != IMAGE_MAGIC) { return -1; }
+
+  //  The hash covers the header, image and protected TLVs. The other TLVs follow, it_tlv_tot includes the info.
+  struct image_check check = {
+    .hashed = (uint32_t) header.ih_hdr_size + header.ih_img_size + header.ih_protect_tlv_size,
+    .field_type = FIELD_INFO,
+    .field_len = sizeof(struct image_tlv_info),
+  };
+  check.field = check.hashed;
+  if (check.hashed > source_size - sizeof(struct image_tlv_info)) { return -1; }
+  uint32_t scanned = source_size;
+  if (!source_packed) {
+    //  Random access: read the TLV info first, so as not to compare the rest of the area
+    struct image_tlv_info tlv_info;
+    read_source(check.hashed, &tlv_info, sizeof(tlv_info));
+    scanned = check.hashed + tlv_info.it_tlv_tot;
+    if (scanned > source_size || scanned > PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE) { return -1; }
   }
 
-  for(uint32_t offset = 0; offset < FACTORY_SIZE; offset += BATCH_SIZE) {
+  //  Compare the sectors, hash the image and find the SHA-256 TLV with the same reads
+  pinetime_sha256_init(&check.sha);
+  for (uint32_t sector = 0; sector < ROUND_TO_SECTOR(scanned); sector += PINETIME_SECTOR_SIZE) {
     hal_watchdog_tickle();
-    rc = hal_flash_read(FLASH_DEVICE, FACTORY_OFFSET_SOURCE + offset, flash_buffer, BATCH_SIZE);
+    sector_states[sector / PINETIME_SECTOR_SIZE] = compare_sector(device, destination, sector, &check);
+  }
+  //  Must not reach the trailer of the slot
+  if (!check.found || check.end > source_size || check.end > PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE) { return -1; }
+  *size = ROUND_TO_SECTOR(check.end);
+  uint8_t digest[PINETIME_SHA256_SIZE];
+  pinetime_sha256_final(&check.sha, digest);
+  return (memcmp(digest, check.value, PINETIME_SHA256_SIZE) == 0) ? 0 : -1;
+}
+
+/// Feed len source bytes at offset to the check: hash the bytes before hashed, and collect the TLV fields
+static void check_source(struct image_check *check, uint32_t offset, const uint8_t *buf, uint32_t len) {
+  if (offset < check->hashed) {
+    uint32_t hashed_len = check->hashed - offset;
+    pinetime_sha256_update(&check->sha, buf, (hashed_len < len) ? hashed_len : len);
+  }
+  while (check->field_type != FIELD_DONE) {
+    //  Copy the part of the field in these bytes, if any
+    uint32_t start = check->field + check->field_read;
+    if (start < offset || start >= offset + len) { return; }
+    uint32_t count = check->field_len - check->field_read;
+    if (count > offset + len - start) { count = offset + len - start; }
+    memcpy(check->value + check->field_read, buf + (start - offset), count);
+    check->field_read += count;
+    if (check->field_read < check->field_len) { return; }
+
+    //  Field complete: find the next one
+    uint32_t next = check->field + check->field_len;
+    if (check->field_type == FIELD_INFO) {
+      struct image_tlv_info tlv_info;
+      memcpy(&tlv_info, check->value, sizeof(tlv_info));
+      if (tlv_info.it_magic != IMAGE_TLV_INFO_MAGIC) { check->field_type = FIELD_DONE; return; }
+      check->end = check->hashed + tlv_info.it_tlv_tot;
+      check->field_type = FIELD_TLV;
+    } else if (check->field_type == FIELD_TLV) {
+      struct image_tlv tlv;
+      memcpy(&tlv, check->value, sizeof(tlv));
+      if (tlv.it_type == IMAGE_TLV_SHA256 && tlv.it_len == PINETIME_SHA256_SIZE) {
+        check->field_type = FIELD_SHA256;
+      } else {
+        next += tlv.it_len;
+      }
+    } else {
+      check->found = 1;
+      check->field_type = FIELD_DONE;
+      return;
+    }
+    check->field = next;
+    check->field_len = (check->field_type == FIELD_SHA256) ? PINETIME_SHA256_SIZE : sizeof(struct image_tlv);
+    check->field_read = 0;
+    if (check->field_type == FIELD_TLV && next + sizeof(struct image_tlv) > check->end) {
+      check->field_type = FIELD_DONE;  //  No SHA-256 TLV
+    }
+  }
+}
+
+/// Erase the last sector of the slot, which holds the MCUBoot trailer, unless it is blank
+static void erase_trailer(int device, uint32_t slot) {
+  uint32_t sector = slot + PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE;
+  for (uint32_t i = 0; i < PINETIME_SECTOR_SIZE; i += PINETIME_BATCH_SIZE) {
+    int rc = hal_flash_read(device, sector + i, flash_buffer, PINETIME_BATCH_SIZE);
+    assert(rc == 0);
+    for (int j = 0; j < PINETIME_BATCH_SIZE; j++) {
+      if (flash_buffer[j] != 0xff) {
+        rc = hal_flash_erase_sector(device, sector);
+        assert(rc == 0);
+        pinetime_info_flash_erase(1);
+        return;
+      }
+    }
+  }
+}
+
+/// Check whether the source image at offset of the flash device, in an area of area_size bytes, is compressed and
+/// start reading it
+static void open_source(int device, uint32_t offset, uint32_t area_size) {
+  struct packed_header header;
+  source_device = device;
+  source_offset = offset;
+  int rc = hal_flash_read(source_device, source_offset, &header, sizeof(header));
+  assert(rc == 0);
+  source_packed = header.magic == PACKED_MAGIC &&
+    header.window_sz2 == PINETIME_HEATSHRINK_WINDOW_SZ2 &&
+    header.lookahead_sz2 == PINETIME_HEATSHRINK_LOOKAHEAD_SZ2 &&
+    header.size >= sizeof(struct image_header) && header.size <= PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE &&
+    header.packed_size <= area_size - sizeof(header);
+  source_size = source_packed ? header.size : area_size;
+  pinetime_heatshrink_init(&source_decoder, source_device, source_offset + sizeof(header));
+  source_position = 0;
+  sector_decoder = source_decoder;
+  sector_position = 0;
+}
+
+/// Read len bytes at offset of the source image. A compressed image is decompressed on the fly, reading again from
+/// the start of the last sector read, or from the start of the image, when going back: scan_image() reads it once
+/// from the start, and the copy reads it once more. Bytes beyond its end are 0xff.
+static void read_source(uint32_t offset, void *buf, uint32_t len) {
+  if (!source_packed) {
+    int rc = hal_flash_read(source_device, source_offset + offset, buf, len);
     assert(rc == 0);
-    rc = hal_flash_write(FLASH_DEVICE, FACTORY_OFFSET_DESTINATION + offset, flash_buffer, BATCH_SIZE);
+    return;
+  }
+  uint32_t available = (offset < source_size) ? source_size - offset : 0;
+  if (available < len) {
+    memset((uint8_t *) buf + available, 0xff, len - available);
+    len = available;
+  }
+  if (len == 0) { return; }
+
+  if (offset < source_position) {
+    if (offset >= sector_position) {
+      source_decoder = sector_decoder;
+      source_position = sector_position;
+    } else {
+      pinetime_heatshrink_init(&source_decoder, source_device, source_offset + sizeof(struct packed_header));
+      source_position = 0;
+    }
+  }
+  uint8_t skipped[32];
+  while (source_position < offset) {
+    uint32_t skip = (offset - source_position < sizeof(skipped)) ? offset - source_position : sizeof(skipped);
+    pinetime_heatshrink_read(&source_decoder, skipped, skip);
+    source_position += skip;
+  }
+  if (offset % PINETIME_SECTOR_SIZE == 0) {
+    sector_decoder = source_decoder;
+    sector_position = offset;
+  }
+  pinetime_heatshrink_read(&source_decoder, buf, len);
+  source_position += len;
+}
+
+/// Compare the sector at destination + offset of the device with the source sector at offset. The source bytes are
+/// fed to the check.
+static enum sector_state compare_sector(int device, uint32_t destination, uint32_t offset,
+  struct image_check *check) {
+  int rc;
+  int same = 1, blank = 1;
+  for (uint32_t i = 0; i < PINETIME_SECTOR_SIZE; i += PINETIME_BATCH_SIZE) {
+    read_source(offset + i, flash_buffer, PINETIME_BATCH_SIZE);
+    check_source(check, offset + i, flash_buffer, PINETIME_BATCH_SIZE);
+    rc = hal_flash_read(device, destination + offset + i, compare_buffer, PINETIME_BATCH_SIZE);
+    assert(rc == 0);
+    if (same && memcmp(flash_buffer, compare_buffer, PINETIME_BATCH_SIZE) != 0) { same = 0; }
+    for (int j = 0; blank && j < PINETIME_BATCH_SIZE; j++) {
+      if (compare_buffer[j] != 0xff) { blank = 0; }
+    }
+  }
+  if (same) { return SECTOR_SAME; }
+  return blank ? SECTOR_BLANK : SECTOR_DIFF;
+}
+
+/// Copy the source sector at offset to the erased sector at destination + offset of the device. Blank batches are not
+/// programmed. Every batch is read back: return 0 if the sector holds the source data, -1 otherwise.
+static int copy_sector(int device, uint32_t destination, uint32_t offset) {
+  int rc;
+  for (uint32_t i = 0; i < PINETIME_SECTOR_SIZE; i += PINETIME_BATCH_SIZE) {
+    read_source(offset + i, flash_buffer, PINETIME_BATCH_SIZE);
+    int blank = 1;
+    for (int j = 0; blank && j < PINETIME_BATCH_SIZE; j++) {
+      if (flash_buffer[j] != 0xff) { blank = 0; }
+    }
+    if (!blank) {
+      rc = hal_flash_write(device, destination + offset + i, flash_buffer, PINETIME_BATCH_SIZE);
+      assert(rc == 0);
+      pinetime_info_flash_write(PINETIME_BATCH_SIZE);
+    }
+    rc = hal_flash_read(device, destination + offset + i, compare_buffer, PINETIME_BATCH_SIZE);
     assert(rc == 0);
+    if (memcmp(flash_buffer, compare_buffer, PINETIME_BATCH_SIZE) != 0) { return -1; }
   }
+  return 0;
 }
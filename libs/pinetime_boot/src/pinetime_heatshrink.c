@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  heatshrink decoder (LZSS with a tiny window, https://github.com/atomicobject/heatshrink), for the compressed
+//  recovery image. The bit stream is read MSB first: 1 + 8-bit literal, or 0 + (distance - 1) on WINDOW_SZ2 bits +
+//  (count - 1) on LOOKAHEAD_SZ2 bits to copy count bytes from distance bytes back.
+#include <os/os.h>
+#include <string.h>
+#include <hal/hal_flash.h>
+#include "pinetime_boot/pinetime_heatshrink.h"
+
+#define WINDOW_MASK ((1 << PINETIME_HEATSHRINK_WINDOW_SZ2) - 1)
+
+void pinetime_heatshrink_init(struct pinetime_heatshrink *hs, int device, uint32_t offset) {
+  memset(hs, 0, sizeof(*hs));
+  hs->device = device;
+  hs->input = offset;
+  hs->in_pos = sizeof(hs->in_buf);  //  Read a batch on the first bit
+}
+
+/// Return the next count bits of the input, MSB first
+static uint16_t get_bits(struct pinetime_heatshrink *hs, int count) {
+  uint16_t value = 0;
+  while (count--) {
+    if (hs->bit_mask == 0) {
+      if (hs->in_pos == sizeof(hs->in_buf)) {
+        int rc = hal_flash_read(hs->device, hs->input, hs->in_buf, sizeof(hs->in_buf));
+        assert(rc == 0);
+        hs->input += sizeof(hs->in_buf);
+        hs->in_pos = 0;
+      }
+      hs->in_byte = hs->in_buf[hs->in_pos++];
+      hs->bit_mask = 0x80;
+    }
+    value = (value << 1) | ((hs->in_byte & hs->bit_mask) ? 1 : 0);
+    hs->bit_mask >>= 1;
+  }
+  return value;
+}
+
+void pinetime_heatshrink_read(struct pinetime_heatshrink *hs, uint8_t *buf, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t c;
+    if (hs->count == 0 && get_bits(hs, 1)) {
+      c = get_bits(hs, 8);  //  Literal
+    } else {
+      if (hs->count == 0) {  //  New match
+        hs->distance = get_bits(hs, PINETIME_HEATSHRINK_WINDOW_SZ2) + 1;
+        hs->count = get_bits(hs, PINETIME_HEATSHRINK_LOOKAHEAD_SZ2) + 1;
+      }
+      c = hs->window[(hs->head - hs->distance) & WINDOW_MASK];
+      hs->count--;
+    }
+    hs->window[hs->head] = c;
+    hs->head = (hs->head + 1) & WINDOW_MASK;
+    buf[i] = c;
+  }
+}
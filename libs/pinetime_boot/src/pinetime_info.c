@@ -0,0 +1,66 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Bootloader to firmware info block in retained RAM
+#include <os/os.h>
+#include <string.h>
+#include <nrf.h>
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/version.h"
+
+/// Not initialised by the startup code, at PINETIME_INFO_ADDRESS: see boot-nrf52xxaa.ld
+struct pinetime_info pinetime_info __attribute__((section(".pinetime_info")));
+
+_Static_assert(sizeof(struct pinetime_info) <= 0x100, "Info block must fit in the INFO region of boot-nrf52xxaa.ld");
+
+void pinetime_info_init(void) {
+  assert((uint32_t) &pinetime_info == PINETIME_INFO_ADDRESS);
+  memset(&pinetime_info, 0, sizeof(pinetime_info));
+  pinetime_info.magic = PINETIME_INFO_MAGIC;
+  pinetime_info.version = PINETIME_INFO_VERSION;
+  pinetime_info.size = sizeof(pinetime_info);
+  pinetime_info.bootloader_version = PINETIME_BOOTLOADER_VERSION;
+  pinetime_info.reset_reason = NRF_POWER->RESETREAS;
+  pinetime_info.action = PINETIME_ACTION_RUN;
+}
+
+void pinetime_info_flash_erase(uint32_t sectors) {
+  pinetime_info.flash_erases += sectors;
+}
+
+void pinetime_info_flash_write(uint32_t bytes) {
+  pinetime_info.flash_writes++;
+  pinetime_info.flash_bytes_written += bytes;
+}
+
+void pinetime_info_seal(void) {
+  pinetime_info.crc = pinetime_crc32(&pinetime_info, offsetof(struct pinetime_info, crc));
+}
+
+/// CRC-32 (IEEE 802.3, reflected), computed bit by bit to keep the bootloader small
+uint32_t pinetime_crc32(const void *buf, uint32_t len) {
+  const uint8_t *data = buf;
+  uint32_t crc = 0xffffffff;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
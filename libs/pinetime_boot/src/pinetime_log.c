@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Boot log: fixed-size records appended to the reboot log page of the internal flash
+#include <os/os.h>
+#include <string.h>
+#include <hal/hal_flash.h>
+#include "pinetime_boot/pinetime_log.h"
+#include "pinetime_boot/pinetime_info.h"
+
+#define FLASH_DEVICE   0      //  Internal Flash ROM
+#define RECORD_COUNT   (PINETIME_LOG_SIZE / sizeof(struct pinetime_log_record))
+#define EMPTY          0xffffffff
+
+_Static_assert(PINETIME_LOG_SIZE % sizeof(struct pinetime_log_record) == 0, "Log must hold whole records");
+
+static const struct pinetime_log_record *records = (const struct pinetime_log_record *) PINETIME_LOG_ADDRESS;
+
+/// Return the first empty slot and the last valid record (NULL if none). Internal flash is memory mapped. A slot that
+/// isn't empty but fails the CRC (interrupted write, or an older layout of the page) is skipped.
+static uint32_t scan_log(const struct pinetime_log_record **last) {
+  uint32_t slot = 0;
+  *last = NULL;
+  for (; slot < RECORD_COUNT && records[slot].sequence != EMPTY; slot++) {
+    int valid = (records[slot].crc == pinetime_crc32(&records[slot], offsetof(struct pinetime_log_record, crc)));
+    if (valid && (*last == NULL || records[slot].sequence >= (*last)->sequence)) { *last = &records[slot]; }
+  }
+  return slot;
+}
+
+int pinetime_log_last_action(void) {
+  const struct pinetime_log_record *last;
+  scan_log(&last);
+  return last ? last->action : -1;
+}
+
+uint32_t pinetime_log_failures(int failed, int started) {
+  uint32_t count = 0;
+  for (uint32_t slot = 0; slot < RECORD_COUNT && records[slot].sequence != EMPTY; slot++) {
+    if (records[slot].crc != pinetime_crc32(&records[slot], offsetof(struct pinetime_log_record, crc))) { continue; }
+    if (records[slot].action == failed) {
+      count++;
+    } else if (records[slot].action != started) {
+      count = 0;
+    }
+  }
+  return count;
+}
+
+void pinetime_log_append(void) {
+  //  Find the first empty slot and the next sequence number
+  const struct pinetime_log_record *last;
+  uint32_t slot = scan_log(&last);
+  uint32_t sequence = last ? last->sequence + 1 : 0;
+  if (slot == RECORD_COUNT) {
+    int rc = hal_flash_erase(FLASH_DEVICE, PINETIME_LOG_ADDRESS, PINETIME_LOG_SIZE); assert(rc == 0);
+    pinetime_info_flash_erase(1);
+    slot = 0;
+  }
+
+  const struct pinetime_timing *timing = &pinetime_info.timing;
+  uint32_t cycles_per_ms = timing->cpu_hz / 1000;
+  struct pinetime_log_record record = {
+    .sequence = sequence,
+    .bootloader_version = pinetime_info.bootloader_version,
+    .reset_reason = pinetime_info.reset_reason,
+    .action = pinetime_info.action,
+    .requested_swap_type = pinetime_info.requested_swap_type,
+    .button_ms = pinetime_info.button_ms,
+    .flash_erases = (pinetime_info.flash_erases > 0xffff) ? 0xffff : pinetime_info.flash_erases,
+    .swap_outcome = pinetime_info.swap_outcome,
+  };
+  //  The cycle counter stops while waiting for the button, and only counts the CPU time of the wait (redrawing the
+  //  progress bar): replace the wait phase by the wall-clock wait time
+  if (timing->cycles[PINETIME_PHASE_START] != 0) {
+    uint32_t wait_cycles = timing->cycles[PINETIME_PHASE_WAIT] - timing->cycles[PINETIME_PHASE_VERSION];
+    uint32_t busy_cycles = timing->cycles[PINETIME_PHASE_START] - timing->cycles[PINETIME_PHASE_BOOT_INIT];
+    record.boot_ms = (busy_cycles - wait_cycles) / cycles_per_ms + timing->wait_ms;
+    record.mcuboot_ms = (timing->cycles[PINETIME_PHASE_MCUBOOT] - timing->cycles[PINETIME_PHASE_WAIT]) / cycles_per_ms;
+  }
+  record.crc = pinetime_crc32(&record, offsetof(struct pinetime_log_record, crc));
+
+  int rc = hal_flash_write(FLASH_DEVICE, PINETIME_LOG_ADDRESS + slot * sizeof(record), &record, sizeof(record));
+  assert(rc == 0);
+  pinetime_info_flash_write(sizeof(record));
+}
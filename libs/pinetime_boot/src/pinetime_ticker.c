@@ -0,0 +1,86 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Periodic tick for sampling the button, without busy waiting.
+//  TIMER4 counts at 1 MHz and raises COMPARE[0] once per tick: CC[0] is moved forward by one period on every tick, so
+//  the timer keeps running and late ticks are counted instead of delaying the next ones. Its interrupt is enabled in the
+//  timer but not in the NVIC, and SEVONPEND is set: the interrupt becomes pending without running a handler, and the
+//  pending transition wakes the CPU from WFE. TIMER0 is used by Mynewt, TIMER2 exports the bootloader version and
+//  TIMER3 chains the display DMA transfers.
+#include <os/os.h>
+#include <nrf.h>
+#include "pinetime_boot/pinetime_ticker.h"
+
+#define TICKER        NRF_TIMER4
+#define TICKER_IRQn   TIMER4_IRQn
+#define TICKER_FREQ   1000000  //  Timer frequency in Hz: 16 MHz / 2^4
+
+static uint32_t period;  //  Timer counts per tick
+
+void pinetime_ticker_start(uint32_t hz) {
+  assert(hz > 0 && hz <= TICKER_FREQ);
+  TICKER->TASKS_STOP = 1;
+  TICKER->MODE = TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos;
+  TICKER->BITMODE = TIMER_BITMODE_BITMODE_32Bit << TIMER_BITMODE_BITMODE_Pos;
+  TICKER->PRESCALER = 4;
+  period = TICKER_FREQ / hz;
+  TICKER->CC[0] = period;
+  TICKER->TASKS_CLEAR = 1;
+  TICKER->EVENTS_COMPARE[0] = 0;
+
+  NVIC_DisableIRQ(TICKER_IRQn);
+  NVIC_ClearPendingIRQ(TICKER_IRQn);
+  TICKER->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+  SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+  TICKER->TASKS_START = 1;
+}
+
+uint32_t pinetime_ticker_wait(void) {
+  //  Other interrupts and events wake the CPU too: sleep again until the tick
+  while (TICKER->EVENTS_COMPARE[0] == 0) {
+    __WFE();
+  }
+  //  Count the ticks that went by while the CPU was busy, and move the compare to the first tick still ahead. If the
+  //  counter passed that tick before the new compare was set, the compare would only match after the counter wraps:
+  //  count again.
+  uint32_t due = TICKER->CC[0];
+  uint32_t ticks, now;
+  do {
+    TICKER->EVENTS_COMPARE[0] = 0;
+    TICKER->TASKS_CAPTURE[1] = 1;
+    ticks = (TICKER->CC[1] - due) / period + 1;
+    TICKER->CC[0] = due + ticks * period;
+    TICKER->TASKS_CAPTURE[1] = 1;
+    now = TICKER->CC[1];
+  } while (now - due >= ticks * period);
+  (void) TICKER->EVENTS_COMPARE[0];  //  Make sure the event is cleared before the interrupt
+  NVIC_ClearPendingIRQ(TICKER_IRQn);
+  return ticks;
+}
+
+void pinetime_ticker_stop(void) {
+  TICKER->TASKS_STOP = 1;
+  TICKER->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk;
+  TICKER->CC[0] = 0;
+  TICKER->CC[1] = 0;
+  TICKER->PRESCALER = 4;  //  Reset value
+  TICKER->BITMODE = 0;
+  TICKER->EVENTS_COMPARE[0] = 0;
+  NVIC_ClearPendingIRQ(TICKER_IRQn);
+  SCB->SCR &= ~SCB_SCR_SEVONPEND_Msk;
+}
@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Boot phase timings with the DWT cycle counter
+#include <os/os.h>
+#include <console/console.h>
+#include <nrf.h>
+#include "pinetime_boot/pinetime_timing.h"
+#include "pinetime_boot/pinetime_info.h"
+
+#define CPU_HZ 64000000  //  nRF52832 CPU clock
+
+void pinetime_timing_start(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  pinetime_info.timing.magic = PINETIME_TIMING_MAGIC;
+  pinetime_info.timing.cpu_hz = CPU_HZ;
+  pinetime_info.timing.count = PINETIME_PHASE_COUNT;
+  pinetime_timing_mark(PINETIME_PHASE_BOOT_INIT);
+}
+
+void pinetime_timing_mark(enum pinetime_phase phase) {
+  assert(phase < PINETIME_PHASE_COUNT);
+  pinetime_info.timing.cycles[phase] = DWT->CYCCNT;
+}
+
+void pinetime_timing_wait_ms(uint32_t ms) {
+  pinetime_info.timing.wait_ms = ms;
+}
+
+void pinetime_timing_report(void) {
+#ifndef DISABLE_SEMIHOSTING  //  If Arm Semihosting is enabled...
+  static const char *names[PINETIME_PHASE_COUNT] = {
+    "boot init", "display init", "logo", "version", "wait", "mcuboot", "vector table", "start"
+  };
+  for (int i = 1; i < PINETIME_PHASE_COUNT; i++) {
+    console_printf("%-12s %8lu us\n", names[i],
+      (unsigned long) ((pinetime_info.timing.cycles[i] - pinetime_info.timing.cycles[i - 1]) / (CPU_HZ / 1000000)));
+  }
+  console_printf("wait         %8lu ms (sleeping)\n", (unsigned long) pinetime_info.timing.wait_ms);
+  console_flush();
+#endif  //  !DISABLE_SEMIHOSTING
+  //  Point the firmware to the info block that contains the table, next to the bootloader version
+  NRF_TIMER2->CC[1] = (uint32_t) &pinetime_info;
+}
@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Non-blocking SPI transmit through the nRF52 SPIM EasyDMA, for the display.
+//  hal_spi_txrx() drives SPI port 0 as the legacy SPI peripheral and feeds every byte from the CPU. For long pixel
+//  transfers we switch the same peripheral to SPIM and let EasyDMA send the buffer while the CPU decodes the next row.
+//  A transfer longer than TXD.MAXCNT (255 bytes on the nRF52832) is sent as a list of chunks: TXD.LIST = ArrayList
+//  advances TXD.PTR after each chunk and PPI restarts the SPIM on every END event, while TIMER3 counts the chunks
+//  and stops the chain after the last one. No interrupt and no CPU work is needed until the transfer completes.
+//  Without ArrayList, TXD.PTR stays put and the same chunk is sent again on every restart: a solid fill of any size
+//  only needs one chunk of pixels in RAM.
+#include "os/mynewt.h"
+#include <nrf.h>
+#include "spim_dma.h"
+
+#define SPIM       NRF_SPIM0  //  SPI port 0: ST7789 display and SPI Flash
+#define SPIM_TIMER NRF_TIMER3 //  Counts the chunks sent. TIMER0 is used by Mynewt, TIMER2 exports the bootloader version
+
+//  PPI channels and group used to chain the chunks. Not used by the bootloader otherwise.
+#define PPI_CH_RESTART 0  //  SPIM END → SPIM START, in PPI_GROUP
+#define PPI_CH_COUNT   1  //  SPIM END → TIMER COUNT
+#define PPI_CH_LAST    2  //  TIMER COMPARE[0] → disable PPI_GROUP, so that the last chunk isn't restarted
+#define PPI_GROUP      0
+
+static int busy = 0;            //  Non-zero while a transfer is pending
+static uint32_t saved_enable;   //  SPI port 0 mode (SPI or SPIM) before the transfer
+
+/// Start sending count chunks of chunk_len bytes from buf on SPI port 0 and return without waiting
+int spim_dma_start(const uint8_t *buf, uint8_t chunk_len, uint16_t count, int mode) {
+    assert(!busy);
+    assert(chunk_len > 0 && count > 0);
+    assert((uint32_t) buf >= 0x20000000);  //  EasyDMA can only read from RAM
+
+    //  Switch SPI port 0 from SPI to SPIM. Pins, frequency and mode are at the same addresses in both peripherals.
+    saved_enable = SPIM->ENABLE;
+    SPIM->ENABLE = SPIM_ENABLE_ENABLE_Disabled << SPIM_ENABLE_ENABLE_Pos;
+    SPIM->ENABLE = SPIM_ENABLE_ENABLE_Enabled << SPIM_ENABLE_ENABLE_Pos;
+
+    SPIM->TXD.PTR = (uint32_t) buf;
+    SPIM->TXD.MAXCNT = chunk_len;
+    SPIM->TXD.LIST = (mode == SPIM_DMA_LIST)
+        ? SPIM_TXD_LIST_LIST_ArrayList << SPIM_TXD_LIST_LIST_Pos
+        : SPIM_TXD_LIST_LIST_Disabled << SPIM_TXD_LIST_LIST_Pos;
+    SPIM->RXD.PTR = 0;
+    SPIM->RXD.MAXCNT = 0;  //  Transmit only
+    SPIM->EVENTS_END = 0;
+
+    //  Count the chunks: COMPARE[0] fires when the last chunk starts, COMPARE[1] when it ends
+    SPIM_TIMER->TASKS_STOP = 1;
+    SPIM_TIMER->MODE = TIMER_MODE_MODE_Counter << TIMER_MODE_MODE_Pos;
+    SPIM_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit << TIMER_BITMODE_BITMODE_Pos;
+    SPIM_TIMER->TASKS_CLEAR = 1;
+    SPIM_TIMER->CC[0] = count - 1;
+    SPIM_TIMER->CC[1] = count;
+    SPIM_TIMER->EVENTS_COMPARE[0] = 0;
+    SPIM_TIMER->EVENTS_COMPARE[1] = 0;
+    SPIM_TIMER->TASKS_START = 1;
+
+    NRF_PPI->CH[PPI_CH_RESTART].EEP = (uint32_t) &SPIM->EVENTS_END;
+    NRF_PPI->CH[PPI_CH_RESTART].TEP = (uint32_t) &SPIM->TASKS_START;
+    NRF_PPI->CH[PPI_CH_COUNT].EEP = (uint32_t) &SPIM->EVENTS_END;
+    NRF_PPI->CH[PPI_CH_COUNT].TEP = (uint32_t) &SPIM_TIMER->TASKS_COUNT;
+    NRF_PPI->CH[PPI_CH_LAST].EEP = (uint32_t) &SPIM_TIMER->EVENTS_COMPARE[0];
+    NRF_PPI->CH[PPI_CH_LAST].TEP = (uint32_t) &NRF_PPI->TASKS_CHG[PPI_GROUP].DIS;
+    NRF_PPI->CHG[PPI_GROUP] = 1 << PPI_CH_RESTART;
+
+    uint32_t channels = (1 << PPI_CH_COUNT) | (1 << PPI_CH_LAST);
+    if (count > 1) { channels |= 1 << PPI_CH_RESTART; }  //  A single chunk is never restarted
+    NRF_PPI->CHENSET = channels;
+
+    busy = 1;
+    SPIM->TASKS_START = 1;
+    return 0;
+}
+
+/// Wait for the transfer started by spim_dma_start() to complete
+void spim_dma_wait(void) {
+    if (!busy) { return; }
+    while (SPIM_TIMER->EVENTS_COMPARE[1] == 0) {}
+
+    //  Release the PPI channels and the timer in their reset state: the firmware may use them without setting them all
+    NRF_PPI->CHENCLR = (1 << PPI_CH_RESTART) | (1 << PPI_CH_COUNT) | (1 << PPI_CH_LAST);
+    NRF_PPI->CHG[PPI_GROUP] = 0;
+    NRF_PPI->CH[PPI_CH_RESTART].EEP = 0;
+    NRF_PPI->CH[PPI_CH_RESTART].TEP = 0;
+    NRF_PPI->CH[PPI_CH_COUNT].EEP = 0;
+    NRF_PPI->CH[PPI_CH_COUNT].TEP = 0;
+    NRF_PPI->CH[PPI_CH_LAST].EEP = 0;
+    NRF_PPI->CH[PPI_CH_LAST].TEP = 0;
+    SPIM_TIMER->TASKS_STOP = 1;
+    SPIM_TIMER->TASKS_CLEAR = 1;
+    SPIM_TIMER->MODE = 0;
+    SPIM_TIMER->BITMODE = 0;
+    SPIM_TIMER->CC[0] = 0;
+    SPIM_TIMER->CC[1] = 0;
+    SPIM_TIMER->EVENTS_COMPARE[0] = 0;
+    SPIM_TIMER->EVENTS_COMPARE[1] = 0;
+
+    //  Hand SPI port 0 back to hal_spi
+    SPIM->EVENTS_END = 0;
+    SPIM->TXD.LIST = SPIM_TXD_LIST_LIST_Disabled << SPIM_TXD_LIST_LIST_Pos;
+    SPIM->ENABLE = SPIM_ENABLE_ENABLE_Disabled << SPIM_ENABLE_ENABLE_Pos;
+    SPIM->ENABLE = saved_enable;
+    busy = 0;
+}
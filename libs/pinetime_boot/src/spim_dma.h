@@ -0,0 +1,40 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Non-blocking SPI transmit through the nRF52 SPIM EasyDMA, for the display
+#ifndef __SPIM_DMA_H__
+#define __SPIM_DMA_H__
+#include <stdint.h>
+
+/// Largest transfer supported by the nRF52832 EasyDMA (TXD.MAXCNT is 8 bits)
+#define SPIM_DMA_MAX_CHUNK 255
+
+//  Transfer modes for spim_dma_start()
+#define SPIM_DMA_LIST   0  //  The chunks follow each other in the buffer
+#define SPIM_DMA_REPEAT 1  //  The same chunk is sent again and again
+
+/// Start sending count chunks of chunk_len bytes from buf on SPI port 0 and return without waiting.
+/// mode is SPIM_DMA_LIST or SPIM_DMA_REPEAT. buf must be in RAM and stay untouched until spim_dma_wait().
+/// Chip select and data/command pins are left to the caller.
+int spim_dma_start(const uint8_t *buf, uint8_t chunk_len, uint16_t count, int mode);
+
+/// Wait for the transfer started by spim_dma_start() to complete. Returns at once if no transfer is pending.
+/// SPI port 0 is handed back to hal_spi in the state it was found, TIMER3 and the PPI channels in their reset state.
+void spim_dma_wait(void);
+
+#endif  //  __SPIM_DMA_H__
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+# SPDX-License-Identifier: Apache-2.0
+
+"""Build a delta image for the PineTime bootloader.
+
+A delta image is sent by OTA into the secondary slot instead of the full
+MCUBoot image. The bootloader uses it to rebuild the new image from the
+image in the primary slot, then MCUBoot checks and swaps it in as usual.
+The layout is struct pinetime_delta_header in
+libs/pinetime_boot/include/pinetime_boot/pinetime_delta.h:
+
+    uint32_t magic          'PTD1'
+    uint32_t size           size of the new image
+    uint32_t source_size    size of the old image (in the primary slot)
+    uint32_t delta_size     size of the operation stream
+    uint8_t  source_sha256[32]
+    uint8_t  delta_sha256[32]
+    uint32_t crc            CRC-32 of the fields above
+
+followed by the operations:
+
+    0 (COPY)   uint32_t offset, uint32_t length   bytes of the old image
+    1 (INSERT) uint32_t length, then the bytes
+
+The delta and the new image must both fit in the secondary slot without
+overlapping, which the tool checks.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+import pinetime_slots
+
+MAGIC = b'PTD1'
+COPY, INSERT = 0, 1
+SLOT_SIZE = pinetime_slots.SLOT_SIZE
+SECTOR_SIZE = pinetime_slots.SECTOR_SIZE
+HEADER_SIZE = 4 * 4 + 32 + 32 + 4
+ANCHOR = 8        # Bytes looked up in the index of the old image
+MIN_COPY = 16     # Shorter matches cost more than inserting the bytes
+CANDIDATES = 16   # Positions of the old image kept per anchor
+
+def diff(old, new):
+    """Greedy match of the new image against the old one: list of (COPY, offset, length) and (INSERT, bytes)."""
+    index = {}
+    for i in range(len(old) - ANCHOR + 1):
+        positions = index.setdefault(old[i:i + ANCHOR], [])
+        if len(positions) < CANDIDATES:
+            positions.append(i)
+    ops, literal = [], bytearray()
+    i = 0
+    while i < len(new):
+        best_offset, best_length = 0, 0
+        for j in index.get(new[i:i + ANCHOR], []):
+            length = 0
+            while i + length < len(new) and j + length < len(old) and new[i + length] == old[j + length]:
+                length += 1
+            if length > best_length:
+                best_offset, best_length = j, length
+        if best_length >= MIN_COPY:
+            if literal:
+                ops.append((INSERT, bytes(literal)))
+                literal = bytearray()
+            ops.append((COPY, best_offset, best_length))
+            i += best_length
+        else:
+            literal.append(new[i])
+            i += 1
+    if literal:
+        ops.append((INSERT, bytes(literal)))
+    return ops
+
+def encode(ops):
+    stream = bytearray()
+    for op in ops:
+        if op[0] == COPY:
+            stream += struct.pack('<BII', COPY, op[1], op[2])
+        else:
+            stream += struct.pack('<BI', INSERT, len(op[1])) + op[1]
+    return bytes(stream)
+
+def apply(old, stream):
+    """Reference decoder, same as pinetime_delta.c."""
+    out, i = bytearray(), 0
+    while i < len(stream):
+        if stream[i] == COPY:
+            offset, length = struct.unpack_from('<II', stream, i + 1)
+            out += old[offset:offset + length]
+            i += 9
+        else:
+            length, = struct.unpack_from('<I', stream, i + 1)
+            out += stream[i + 5:i + 5 + length]
+            i += 5 + length
+    return bytes(out)
+
+parser = argparse.ArgumentParser(description='Build a delta image for the bootloader.')
+parser.add_argument('old', help='MCUBoot image currently installed (.bin)')
+parser.add_argument('new', help='new MCUBoot image (.bin)')
+parser.add_argument('output', help='delta image, to be sent by OTA instead of the new image')
+args = parser.parse_args()
+
+with open(args.old, 'rb') as f:
+    old = f.read()
+with open(args.new, 'rb') as f:
+    new = f.read()
+
+stream = encode(diff(old, new))
+if apply(old, stream) != new:
+    sys.exit('internal error: delta does not rebuild the new image')
+
+# Same checks as read_header() in pinetime_delta.c: the stash at the end of the slot must not overlap the new image
+# or the delta image
+stash_header = SLOT_SIZE - SECTOR_SIZE - HEADER_SIZE
+stash_start = (stash_header - len(stream)) // SECTOR_SIZE * SECTOR_SIZE
+new_end = (len(new) + SECTOR_SIZE - 1) // SECTOR_SIZE * SECTOR_SIZE
+if stash_start < HEADER_SIZE + len(stream) or stash_start < new_end:
+    sys.exit('{}: delta of {} bytes is too large for the slot, send the full image'.format(args.output, len(stream)))
+
+header = MAGIC + struct.pack('<III', len(new), len(old), len(stream))
+header += hashlib.sha256(old).digest() + hashlib.sha256(stream).digest()
+header += struct.pack('<I', zlib.crc32(header))
+assert len(header) == HEADER_SIZE
+
+with open(args.output, 'wb') as f:
+    f.write(header + stream)
+print('{}: {} bytes for a new image of {} bytes ({:.0%})'.format(
+    args.output, len(header) + len(stream), len(new), (len(header) + len(stream)) / len(new)))
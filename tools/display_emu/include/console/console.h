@@ -0,0 +1,8 @@
+//  Host shim for the semihosting console: prints to stderr
+#ifndef __HOST_CONSOLE_H__
+#define __HOST_CONSOLE_H__
+
+int console_printf(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+void console_flush(void);
+
+#endif  //  __HOST_CONSOLE_H__
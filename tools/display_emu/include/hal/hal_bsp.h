@@ -0,0 +1,5 @@
+//  Host shim: hal_bsp is not used by display.c on the host
+#ifndef __HOST_HAL_BSP_H__
+#define __HOST_HAL_BSP_H__
+
+#endif  //  __HOST_HAL_BSP_H__
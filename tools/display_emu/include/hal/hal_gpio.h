@@ -0,0 +1,13 @@
+//  Host shim for hal_gpio: pins are recorded by the ST7789 emulator
+#ifndef __HOST_HAL_GPIO_H__
+#define __HOST_HAL_GPIO_H__
+
+enum hal_gpio_pull { HAL_GPIO_PULL_NONE = 0, HAL_GPIO_PULL_UP = 1, HAL_GPIO_PULL_DOWN = 2 };
+typedef enum hal_gpio_pull hal_gpio_pull_t;
+
+int hal_gpio_init_in(int pin, hal_gpio_pull_t pull);
+int hal_gpio_init_out(int pin, int val);
+void hal_gpio_write(int pin, int val);
+int hal_gpio_read(int pin);
+
+#endif  //  __HOST_HAL_GPIO_H__
@@ -0,0 +1,7 @@
+//  Host shim for hal_spi: bytes are fed to the ST7789 emulator
+#ifndef __HOST_HAL_SPI_H__
+#define __HOST_HAL_SPI_H__
+
+int hal_spi_txrx(int spi_num, void *txbuf, void *rxbuf, int cnt);
+
+#endif  //  __HOST_HAL_SPI_H__
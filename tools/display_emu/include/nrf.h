@@ -0,0 +1,17 @@
+//  Host shim for the nRF52 registers used by the display driver
+#ifndef __HOST_NRF_H__
+#define __HOST_NRF_H__
+#include <stdint.h>
+
+typedef struct {
+  volatile uint32_t RESETREAS;
+} NRF_POWER_Type;
+extern NRF_POWER_Type emu_power;
+#define NRF_POWER (&emu_power)
+
+#define POWER_RESETREAS_RESETPIN_Msk (1UL << 0)
+#define POWER_RESETREAS_DOG_Msk      (1UL << 1)
+#define POWER_RESETREAS_SREQ_Msk     (1UL << 2)
+#define POWER_RESETREAS_LOCKUP_Msk   (1UL << 3)
+
+#endif  //  __HOST_NRF_H__
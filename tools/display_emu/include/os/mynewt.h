@@ -0,0 +1,11 @@
+//  Host shim for os/mynewt.h: just enough of Mynewt for display.c to build on Linux
+#ifndef __HOST_OS_MYNEWT_H__
+#define __HOST_OS_MYNEWT_H__
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "syscfg.h"
+
+#define MYNEWT_VAL(name) MYNEWT_VAL_ ## name
+
+#endif  //  __HOST_OS_MYNEWT_H__
@@ -0,0 +1,9 @@
+//  Host shim for the generated syscfg.h: defaults from libs/pinetime_boot/syscfg.yml
+#ifndef __HOST_SYSCFG_H__
+#define __HOST_SYSCFG_H__
+
+#define MYNEWT_VAL_PINETIME_BOOT_DISPLAY_PANEL (0)
+
+#define MYNEWT_VAL_PINETIME_BOOT_DISPLAY_WARM_START (1)
+
+#endif  //  __HOST_SYSCFG_H__
@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Run the bootloader's display sequence against the ST7789 emulator and report SPI traffic per call
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pinetime_boot/pinetime_boot.h"
+#include <nrf.h>
+#include "st7789_emu.h"
+
+static const char *png_dir = NULL;
+static int step = 0;
+static struct st7789_stats totals;
+
+/// FNV-1a hash of the framebuffer, to compare renderings between builds
+static uint32_t framebuffer_hash(void) {
+  uint32_t h = 2166136261u;
+  const uint8_t *p = (const uint8_t *) st7789_framebuffer;
+  for (size_t i = 0; i < sizeof(st7789_framebuffer); i++) { h = (h ^ p[i]) * 16777619u; }
+  return h;
+}
+
+/// Print the traffic of the last call and the framebuffer hash, then dump a PNG if requested
+static void finish(const char *label) {
+  char line[64];
+  snprintf(line, sizeof(line), "%02d %s", step, label);
+  st7789_emu_print_stats(stdout, line);
+  printf("   framebuffer=%08x\n", framebuffer_hash());
+  if (png_dir) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%02d-%s.png", png_dir, step, label);
+    st7789_emu_write_png(path);
+  }
+  totals.transactions += st7789_stats.transactions;
+  totals.cs_toggles += st7789_stats.cs_toggles;
+  totals.dc_toggles += st7789_stats.dc_toggles;
+  totals.spi_calls += st7789_stats.spi_calls;
+  totals.dma_starts += st7789_stats.dma_starts;
+  totals.commands += st7789_stats.commands;
+  totals.bytes += st7789_stats.bytes;
+  totals.pixels += st7789_stats.pixels;
+  st7789_emu_reset_stats();
+  step++;
+}
+
+int main(int argc, char **argv) {
+  int hold = 1;  //  Simulate the button held for the whole wait
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) { png_dir = argv[++i]; }
+    else if (strcmp(argv[i], "-v") == 0) { emu_verbose = 1; }
+    else if (strcmp(argv[i], "--release") == 0) { hold = 0; }
+    else if (strcmp(argv[i], "--warm") == 0) { NRF_POWER->RESETREAS = POWER_RESETREAS_SREQ_Msk; }
+    else if (strcmp(argv[i], "--resetreas") == 0 && i + 1 < argc) { NRF_POWER->RESETREAS = strtoul(argv[++i], NULL, 0); }
+    else {
+      fprintf(stderr, "usage: %s [-o png_dir] [-v] [--release] [--warm] [--resetreas value]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  pinetime_boot_display_image();
+  finish("boot_logo");
+  pinetime_version_image();
+  finish("version");
+
+  //  Same progress sequence as the wait loop in pinetime_boot_init()
+  uint32_t button_ticks = 0;
+  for (int i = 0; i < 64 * 5; i++) {
+    button_ticks += hold;
+    if (i % 8 == 0) {
+      uint16_t color;
+      if (button_ticks < 64 * 2) {
+        color = GREEN;
+      } else if (button_ticks < 64 * 4) {
+        color = BLUE;
+      } else {
+        color = RED;
+      }
+      pinetime_boot_update_image_colors(WHITE, color, 240 - ((i / 8) * 6) + 1);
+      char label[32];
+      snprintf(label, sizeof(label), "progress_%03d", i);
+      finish(label);
+    }
+  }
+
+  st7789_stats = totals;
+  st7789_emu_print_stats(stdout, "total");
+  printf("   delay_ms=%u errors=%u\n", emu_delay_ms, emu_errors);
+  return emu_errors ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Minimal PNG writer for the emulated framebuffer: RGB888, uncompressed deflate blocks
+#include <stdio.h>
+#include <stdint.h>
+#include "st7789_emu.h"
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+  if (crc_table[1] == 0) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) { c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1; }
+      crc_table[n] = c;
+    }
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) { crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8); }
+  return ~crc;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len) {
+  uint8_t hdr[8];
+  put32(hdr, len);
+  for (int i = 0; i < 4; i++) { hdr[4 + i] = type[i]; }
+  fwrite(hdr, 1, 8, f);
+  fwrite(data, 1, len, f);
+  uint32_t crc = crc32_update(0, hdr + 4, 4);
+  crc = crc32_update(crc, data, len);
+  uint8_t tail[4];
+  put32(tail, crc);
+  fwrite(tail, 1, 4, f);
+}
+
+int st7789_emu_write_png(const char *path) {
+  //  One filter byte plus RGB888 per row, each row stored in its own deflate block
+  enum { ROW_BYTES = 1 + EMU_COLS * 3, BLOCK_BYTES = 5 + ROW_BYTES };
+  static uint8_t idat[2 + EMU_ROWS * BLOCK_BYTES + 4];
+  uint8_t *p = idat;
+  uint32_t a = 1, b = 0;  //  Adler-32 of the raw image data
+
+  *p++ = 0x78; *p++ = 0x01;  //  zlib header, no compression
+  for (int y = 0; y < EMU_ROWS; y++) {
+    *p++ = (y == EMU_ROWS - 1) ? 1 : 0;  //  BFINAL on the last block, BTYPE = stored
+    *p++ = ROW_BYTES & 0xff; *p++ = ROW_BYTES >> 8;
+    *p++ = ~ROW_BYTES & 0xff; *p++ = (~ROW_BYTES >> 8) & 0xff;
+    uint8_t *row = p;
+    *p++ = 0;  //  Filter type: none
+    for (int x = 0; x < EMU_COLS; x++) {
+      uint16_t c = st7789_framebuffer[y][x];
+      *p++ = ((c >> 11) & 0x1f) * 255 / 31;
+      *p++ = ((c >> 5) & 0x3f) * 255 / 63;
+      *p++ = (c & 0x1f) * 255 / 31;
+    }
+    for (uint8_t *q = row; q < p; q++) {
+      a = (a + *q) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+  put32(p, (b << 16) | a);
+  p += 4;
+
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) { perror(path); return -1; }
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  fwrite(signature, 1, 8, f);
+  uint8_t ihdr[13] = { 0 };
+  put32(ihdr, EMU_COLS);
+  put32(ihdr + 4, EMU_ROWS);
+  ihdr[8] = 8;  //  Bit depth
+  ihdr[9] = 2;  //  Colour type: RGB
+  write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+  write_chunk(f, "IDAT", idat, p - idat);
+  write_chunk(f, "IEND", NULL, 0);
+  fclose(f);
+  return 0;
+}
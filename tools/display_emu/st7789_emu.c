@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  ST7789 display controller emulator: decodes the command stream sent by display.c into a framebuffer
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "st7789_emu.h"
+
+//  Pins and commands must match libs/pinetime_boot/src/display.c
+#define DISPLAY_CS   25
+#define DISPLAY_DC   18
+#define DISPLAY_RST  26
+#define CASET 0x2A
+#define RASET 0x2B
+#define RAMWR 0x2C
+
+uint16_t st7789_framebuffer[EMU_ROWS][EMU_COLS];
+struct st7789_stats st7789_stats;
+
+static int cs = 1;        //  Chip select (active low)
+static int dc = 0;        //  0 for command, 1 for data
+static uint8_t command;   //  Last command received
+static uint8_t params[4]; //  Parameters of CASET / RASET
+static int param_count;   //  Number of data bytes received since the last command
+static int pixel_hi = -1; //  High byte of the pixel being received, -1 if none
+static uint16_t xs, xe, ys, ye;  //  Address window
+static uint16_t x, y;     //  Current write position
+
+void st7789_emu_reset_stats(void) {
+  memset(&st7789_stats, 0, sizeof(st7789_stats));
+}
+
+void st7789_emu_print_stats(FILE *f, const char *label) {
+  fprintf(f, "%-28s transactions=%-6u cs_toggles=%-6u dc_toggles=%-6u spi_calls=%-6u dma=%-6u commands=%-6u bytes=%-7u pixels=%u\n",
+    label, st7789_stats.transactions, st7789_stats.cs_toggles, st7789_stats.dc_toggles, st7789_stats.spi_calls,
+    st7789_stats.dma_starts, st7789_stats.commands, st7789_stats.bytes, st7789_stats.pixels);
+}
+
+void st7789_emu_gpio(int pin, int val) {
+  val = val ? 1 : 0;
+  if (pin == DISPLAY_CS && val != cs) {
+    cs = val;
+    st7789_stats.cs_toggles++;
+    if (cs == 0) { st7789_stats.transactions++; }
+    //  A byte can't be split across CS cycles
+    pixel_hi = -1;
+  } else if (pin == DISPLAY_DC && val != dc) {
+    dc = val;
+    st7789_stats.dc_toggles++;
+  } else if (pin == DISPLAY_RST && val == 0) {
+    command = 0;
+    param_count = 0;
+  }
+}
+
+static void write_pixel(uint16_t color) {
+  if (x < EMU_COLS && y < EMU_ROWS) {
+    st7789_framebuffer[y][x] = color;
+  }
+  st7789_stats.pixels++;
+  if (x == xe) {
+    x = xs;
+    y = (y == ye) ? ys : y + 1;
+  } else {
+    x++;
+  }
+}
+
+static void write_byte(uint8_t b) {
+  if (dc == 0) {
+    command = b;
+    param_count = 0;
+    pixel_hi = -1;
+    st7789_stats.commands++;
+    if (command == RAMWR) { x = xs; y = ys; }
+    return;
+  }
+  switch (command) {
+    case CASET:
+    case RASET:
+      if (param_count < 4) { params[param_count] = b; }
+      if (param_count == 3) {
+        uint16_t start = (params[0] << 8) | params[1];
+        uint16_t end = (params[2] << 8) | params[3];
+        if (command == CASET) { xs = start; xe = end; } else { ys = start; ye = end; }
+      }
+      break;
+    case RAMWR:
+      if (pixel_hi < 0) {
+        pixel_hi = b;
+      } else {
+        write_pixel((pixel_hi << 8) | b);
+        pixel_hi = -1;
+      }
+      break;
+    default:
+      break;
+  }
+  param_count++;
+}
+
+void st7789_emu_spi(const uint8_t *data, int len) {
+  st7789_stats.bytes += len;
+  if (cs) {
+    fprintf(stderr, "st7789_emu: %d bytes sent while CS is high\n", len);
+    return;
+  }
+  for (int i = 0; i < len; i++) { write_byte(data[i]); }
+}
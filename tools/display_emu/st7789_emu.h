@@ -0,0 +1,59 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  ST7789 display controller emulator and SPI trace recorder for the host build of display.c
+#ifndef __ST7789_EMU_H__
+#define __ST7789_EMU_H__
+#include <stdint.h>
+#include <stdio.h>
+
+#define EMU_COLS 240
+#define EMU_ROWS 240
+
+/// SPI traffic seen by the emulator since the last st7789_emu_reset_stats()
+struct st7789_stats {
+  uint32_t transactions;  //  Number of times CS was asserted
+  uint32_t cs_toggles;    //  Number of CS level changes
+  uint32_t dc_toggles;    //  Number of DC level changes
+  uint32_t spi_calls;     //  Number of hal_spi_txrx() calls
+  uint32_t dma_starts;    //  Number of EasyDMA transfers started
+  uint32_t commands;      //  Number of command bytes
+  uint32_t bytes;         //  Total number of bytes on the bus
+  uint32_t pixels;        //  Number of pixels written to display RAM
+};
+
+/// Emulated display RAM in RGB565
+extern uint16_t st7789_framebuffer[EMU_ROWS][EMU_COLS];
+
+/// Traffic counters
+extern struct st7789_stats st7789_stats;
+
+void st7789_emu_reset_stats(void);
+void st7789_emu_print_stats(FILE *f, const char *label);
+int st7789_emu_write_png(const char *path);
+
+/// Feed a GPIO level change or bytes clocked out on the SPI bus
+void st7789_emu_gpio(int pin, int val);
+void st7789_emu_spi(const uint8_t *data, int len);
+
+//  Host stubs for the Mynewt HAL (stubs.c)
+extern int emu_verbose;         //  Print console output if non-zero
+extern uint32_t emu_delay_ms;   //  Total time spent in pinetime_delay_ms()
+extern uint32_t emu_errors;     //  Number of pin changes, SPI calls or buffer writes during an EasyDMA transfer
+
+#endif  //  __ST7789_EMU_H__
@@ -0,0 +1,117 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Host stubs for the Mynewt HAL and console calls made by display.c
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <console/console.h>
+#include <hal/hal_gpio.h>
+#include <hal/hal_spi.h>
+#include "pinetime_boot/pinetime_delay.h"
+#include "pinetime_boot/pinetime_timing.h"
+#include "spim_dma.h"
+#include <nrf.h>
+#include "st7789_emu.h"
+
+NRF_POWER_Type emu_power;
+
+int emu_verbose = 0;
+uint32_t emu_delay_ms;
+uint32_t emu_errors;
+
+int console_printf(const char *fmt, ...) {
+  if (!emu_verbose) { return 0; }
+  va_list ap;
+  va_start(ap, fmt);
+  int rc = vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  return rc;
+}
+
+void console_flush(void) {}
+
+int hal_gpio_init_in(int pin, hal_gpio_pull_t pull) { (void) pin; (void) pull; return 0; }
+
+static int emu_dma_pending(void);
+
+static void check_dma_idle(const char *what) {
+  if (emu_dma_pending()) {
+    fprintf(stderr, "display_emu: %s during EasyDMA transfer\n", what);
+    emu_errors++;
+  }
+}
+
+int hal_gpio_init_out(int pin, int val) {
+  check_dma_idle("GPIO init");
+  st7789_emu_gpio(pin, val);
+  return 0;
+}
+
+void hal_gpio_write(int pin, int val) {
+  check_dma_idle("GPIO write");
+  st7789_emu_gpio(pin, val);
+}
+
+int hal_gpio_read(int pin) { (void) pin; return 0; }
+
+int hal_spi_txrx(int spi_num, void *txbuf, void *rxbuf, int cnt) {
+  (void) spi_num; (void) rxbuf;
+  check_dma_idle("hal_spi_txrx()");
+  st7789_stats.spi_calls++;
+  st7789_emu_spi(txbuf, cnt);
+  return 0;
+}
+
+void pinetime_delay_us(uint32_t time_us) { (void) time_us; }
+
+void pinetime_delay_ms(uint32_t ms) { emu_delay_ms += ms; }
+
+void pinetime_timing_mark(enum pinetime_phase phase) { (void) phase; }
+
+//  EasyDMA transfers are replayed into the emulator when they complete, so that a pin change or a buffer
+//  modified while the transfer is pending shows up as an error.
+static const uint8_t *dma_buf;
+static int dma_len;     //  Length of a chunk
+static int dma_count;   //  Number of times the chunk is sent: more than 1 for SPIM_DMA_REPEAT
+static uint8_t dma_copy[4096];
+
+int spim_dma_start(const uint8_t *buf, uint8_t chunk_len, uint16_t count, int mode) {
+  assert(dma_buf == NULL);
+  dma_buf = buf;
+  dma_len = (mode == SPIM_DMA_LIST) ? chunk_len * count : chunk_len;
+  dma_count = (mode == SPIM_DMA_LIST) ? 1 : count;
+  assert(dma_len <= (int) sizeof(dma_copy));
+  memcpy(dma_copy, buf, dma_len);
+  st7789_stats.dma_starts += count;
+  return 0;
+}
+
+void spim_dma_wait(void) {
+  if (dma_buf == NULL) { return; }
+  if (memcmp(dma_copy, dma_buf, dma_len) != 0) {
+    fprintf(stderr, "display_emu: buffer modified during EasyDMA transfer\n");
+    emu_errors++;
+  }
+  for (int i = 0; i < dma_count; i++) { st7789_emu_spi(dma_copy, dma_len); }
+  dma_buf = NULL;
+}
+
+static int emu_dma_pending(void) { return dma_buf != NULL; }
@@ -0,0 +1,124 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  NOR flash emulator: erase sets bytes to 0xff, programming can only clear bits
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hal/hal_flash.h>
+#include "flash_emu.h"
+
+uint8_t *flash_emu_data[FLASH_EMU_DEVICES];
+const uint32_t flash_emu_size[FLASH_EMU_DEVICES] = { 0x80000, 0x400000 };
+struct flash_emu_stats flash_emu_stats;
+
+static int stuck_device = -1;
+static uint32_t stuck_address;
+static int reset_device = -1;
+static uint32_t reset_address, reset_skip;
+jmp_buf flash_emu_reset_point;
+
+/// Abort on an access outside of the device: the caller has a bug, not the flash
+static void check_range(uint8_t flash_id, uint32_t address, uint32_t len, const char *op) {
+  if (flash_id >= FLASH_EMU_DEVICES || address > flash_emu_size[flash_id] ||
+      len > flash_emu_size[flash_id] - address) {
+    fprintf(stderr, "%s out of range: device %u, address 0x%x, %u bytes\n", op, flash_id, address, len);
+    abort();
+  }
+}
+
+void flash_emu_init(void) {
+  for (int i = 0; i < FLASH_EMU_DEVICES; i++) {
+    if (!flash_emu_data[i]) { flash_emu_data[i] = malloc(flash_emu_size[i]); }
+    memset(flash_emu_data[i], 0xff, flash_emu_size[i]);
+  }
+  stuck_device = -1;
+  reset_device = -1;
+  flash_emu_reset_stats();
+}
+
+void flash_emu_fill(int device, uint32_t address, uint8_t value, uint32_t len) {
+  check_range(device, address, len, "fill");
+  memset(flash_emu_data[device] + address, value, len);
+}
+
+void flash_emu_load(int device, uint32_t address, const void *data, uint32_t len) {
+  check_range(device, address, len, "load");
+  memcpy(flash_emu_data[device] + address, data, len);
+}
+
+void flash_emu_stuck(int device, uint32_t address) {
+  stuck_device = device;
+  stuck_address = address;
+}
+
+void flash_emu_reset_on_erase(int device, uint32_t address, uint32_t skip) {
+  reset_device = device;
+  reset_address = address;
+  reset_skip = skip;
+}
+
+void flash_emu_reset_stats(void) {
+  memset(&flash_emu_stats, 0, sizeof(flash_emu_stats));
+}
+
+int hal_flash_read(uint8_t flash_id, uint32_t address, void *dst, uint32_t num_bytes) {
+  check_range(flash_id, address, num_bytes, "read");
+  memcpy(dst, flash_emu_data[flash_id] + address, num_bytes);
+  flash_emu_stats.reads++;
+  flash_emu_stats.bytes_read[flash_id] += num_bytes;
+  return 0;
+}
+
+int hal_flash_write(uint8_t flash_id, uint32_t address, const void *src, uint32_t num_bytes) {
+  check_range(flash_id, address, num_bytes, "write");
+  const uint8_t *data = src;
+  for (uint32_t i = 0; i < num_bytes; i++) { flash_emu_data[flash_id][address + i] &= data[i]; }
+  if (stuck_device == flash_id && stuck_address >= address && stuck_address - address < num_bytes) {
+    flash_emu_data[flash_id][stuck_address] = 0xff;
+  }
+  flash_emu_stats.writes++;
+  return 0;
+}
+
+int hal_flash_erase_sector(uint8_t flash_id, uint32_t sector_address) {
+  check_range(flash_id, sector_address, FLASH_EMU_SECTOR_SIZE, "erase");
+  if (sector_address % FLASH_EMU_SECTOR_SIZE != 0) {
+    fprintf(stderr, "erase of an unaligned sector: device %u, address 0x%x\n", flash_id, sector_address);
+    abort();
+  }
+  if (reset_device == flash_id && reset_address == sector_address && reset_skip-- == 0) {
+    reset_device = -1;
+    longjmp(flash_emu_reset_point, 1);
+  }
+  memset(flash_emu_data[flash_id] + sector_address, 0xff, FLASH_EMU_SECTOR_SIZE);
+  flash_emu_stats.sector_erases++;
+  return 0;
+}
+
+int hal_flash_erase(uint8_t flash_id, uint32_t address, uint32_t num_bytes) {
+  check_range(flash_id, address, num_bytes, "erase");
+  if (address % FLASH_EMU_SECTOR_SIZE != 0 || num_bytes % FLASH_EMU_SECTOR_SIZE != 0) {
+    fprintf(stderr, "erase of an unaligned range: device %u, address 0x%x, %u bytes\n", flash_id, address, num_bytes);
+    abort();
+  }
+  memset(flash_emu_data[flash_id] + address, 0xff, num_bytes);
+  flash_emu_stats.sector_erases += num_bytes / FLASH_EMU_SECTOR_SIZE;
+  if (address % 0x10000 == 0 && num_bytes == 0x10000) { flash_emu_stats.block_erases++; }
+  return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  NOR flash emulator for the host build of pinetime_factory.c: the internal flash and the external SPI Flash in RAM
+#ifndef __FLASH_EMU_H__
+#define __FLASH_EMU_H__
+#include <stdint.h>
+#include <setjmp.h>
+
+#define FLASH_EMU_DEVICES     2
+#define FLASH_EMU_SECTOR_SIZE 0x1000
+
+/// Contents of each device: 512 KB of internal flash (device 0), 4 MB of external SPI Flash (device 1)
+extern uint8_t *flash_emu_data[FLASH_EMU_DEVICES];
+extern const uint32_t flash_emu_size[FLASH_EMU_DEVICES];
+
+/// Operations done through hal_flash since the last flash_emu_reset_stats()
+struct flash_emu_stats {
+  uint32_t reads;
+  uint32_t bytes_read[FLASH_EMU_DEVICES];  //  Bytes read from each device
+  uint32_t writes;
+  uint32_t sector_erases;  //  Sectors erased, by hal_flash_erase_sector() or hal_flash_erase()
+  uint32_t block_erases;   //  hal_flash_erase() calls on a 64 KB aligned block
+};
+extern struct flash_emu_stats flash_emu_stats;
+
+/// Erase both devices
+void flash_emu_init(void);
+
+/// Fill or load flash directly, without going through hal_flash
+void flash_emu_fill(int device, uint32_t address, uint8_t value, uint32_t len);
+void flash_emu_load(int device, uint32_t address, const void *data, uint32_t len);
+
+/// Make the byte at address of the device stay erased whatever is programmed, like a worn-out cell. Pass a negative
+/// device to clear it.
+void flash_emu_stuck(int device, uint32_t address);
+
+/// Simulate a reset just before hal_flash_erase_sector() erases the sector at address of the device for the
+/// (skip + 1)th time: the erase longjmps to flash_emu_reset_point instead, which the caller must set with setjmp().
+/// The reset only happens once. Pass a negative device to clear it.
+void flash_emu_reset_on_erase(int device, uint32_t address, uint32_t skip);
+extern jmp_buf flash_emu_reset_point;
+
+void flash_emu_reset_stats(void);
+
+#endif  //  __FLASH_EMU_H__
@@ -0,0 +1,11 @@
+//  Host shim for hal_flash: both flash devices are emulated in RAM by flash_emu.c
+#ifndef __HOST_HAL_FLASH_H__
+#define __HOST_HAL_FLASH_H__
+#include <stdint.h>
+
+int hal_flash_read(uint8_t flash_id, uint32_t address, void *dst, uint32_t num_bytes);
+int hal_flash_write(uint8_t flash_id, uint32_t address, const void *src, uint32_t num_bytes);
+int hal_flash_erase_sector(uint8_t flash_id, uint32_t sector_address);
+int hal_flash_erase(uint8_t flash_id, uint32_t address, uint32_t num_bytes);
+
+#endif  //  __HOST_HAL_FLASH_H__
@@ -0,0 +1,7 @@
+//  Host shim for hal_watchdog
+#ifndef __HOST_HAL_WATCHDOG_H__
+#define __HOST_HAL_WATCHDOG_H__
+
+void hal_watchdog_tickle(void);
+
+#endif  //  __HOST_HAL_WATCHDOG_H__
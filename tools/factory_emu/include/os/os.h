@@ -0,0 +1,6 @@
+//  Host shim for os/os.h
+#ifndef __HOST_OS_OS_H__
+#define __HOST_OS_OS_H__
+#include "mynewt.h"
+
+#endif  //  __HOST_OS_OS_H__
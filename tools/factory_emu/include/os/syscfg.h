@@ -0,0 +1,10 @@
+//  Host shim for the generated syscfg.h: SPI Flash timings from hw/bsp/nrf52/syscfg.yml
+#ifndef __HOST_SYSCFG_H__
+#define __HOST_SYSCFG_H__
+
+#define MYNEWT_VAL_SPIFLASH_PAGE_SIZE (256)
+#define MYNEWT_VAL_SPIFLASH_TPP_TYPICAL (700)
+#define MYNEWT_VAL_SPIFLASH_TSE_TYPICAL (30000)
+#define MYNEWT_VAL_SPIFLASH_TBE2_TYPICAL (150000)
+
+#endif  //  __HOST_SYSCFG_H__
@@ -0,0 +1,322 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Run the recovery restore, the direct install and the compressed update of pinetime_factory.c, and the delta rebuild
+//  of pinetime_delta.c, against emulated flash
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pinetime_boot/pinetime_factory.h"
+#include "pinetime_boot/pinetime_delta.h"
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/pinetime_slots.h"
+#include "flash_emu.h"
+#include "stubs.h"
+
+#define PACKED_HEADER_SIZE 16  //  Size of the header written by factory_pack.py
+#define OLD_FIRMWARE       0x5a  //  Fill byte of the slots before the recovery firmware is copied
+
+static uint32_t failures;
+
+static void check(int ok, const char *source, const char *label) {
+  printf("%-4s %-6s %s\n", ok ? "ok" : "FAIL", source, label);
+  if (!ok) { failures++; }
+}
+
+/// Read a whole file, exit on error
+static uint8_t *read_file(const char *path, uint32_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f) { perror(path); exit(2); }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(*size);
+  if (fread(data, 1, *size, f) != *size) { perror(path); exit(2); }
+  fclose(f);
+  return data;
+}
+
+/// Return non-zero if the slot at offset of the device starts with the image
+static int slot_holds(int device, uint32_t offset, const uint8_t *image, uint32_t image_size) {
+  return memcmp(flash_emu_data[device] + offset, image, image_size) == 0;
+}
+
+/// Return non-zero if the bytes in [start, end) of the device are blank
+static int range_blank(int device, uint32_t start, uint32_t end) {
+  for (uint32_t i = start; i < end; i++) {
+    if (flash_emu_data[device][i] != 0xff) { return 0; }
+  }
+  return 1;
+}
+
+/// Return non-zero if the last sector of the slot, which holds the MCUBoot trailer, is blank
+static int trailer_blank(int device, uint32_t offset) {
+  uint32_t trailer = offset + PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE;
+  return range_blank(device, trailer, trailer + PINETIME_SECTOR_SIZE);
+}
+
+/// Return non-zero if the boot log holds these actions, in this order
+static int log_is(uint32_t count, const uint8_t *actions) {
+  return emu_log_count == count && memcmp(emu_log, actions, count) == 0;
+}
+
+/// Put an old firmware with a pending MCUBoot trailer in the slot
+static void fill_slot(int device, uint32_t offset) {
+  flash_emu_fill(device, offset, OLD_FIRMWARE, PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE);
+  flash_emu_fill(device, offset + PINETIME_SLOT_SIZE - 16, 0x77, 16);
+}
+
+/// Flip a byte of the source area: in the image for a plain image, in the heatshrink stream for a compressed image
+static void corrupt(uint32_t area, uint32_t source_size) {
+  uint32_t offset = area + source_size / 2;
+  flash_emu_data[PINETIME_RECOVERY_DEVICE][offset] ^= 0x01;
+}
+
+/// Restore the recovery firmware to the secondary slot, and install it in the primary slot, from a source that is the
+/// plain image or the image compressed by factory_pack.py
+static void test_recovery(const char *name, const uint8_t *source, uint32_t source_size,
+  const uint8_t *image, uint32_t image_size) {
+  uint8_t *snapshot = malloc(PINETIME_SLOT_SIZE);
+
+  //  Restore to the secondary slot
+  flash_emu_init();
+  emu_reset_log();
+  flash_emu_load(PINETIME_RECOVERY_DEVICE, PINETIME_RECOVERY_OFFSET, source, source_size);
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  int rc = restore_factory();
+  check(rc > 0, name, "restore: sectors rewritten");
+  check(slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, image, image_size), name,
+    "restore: secondary slot holds the image");
+  check(flash_emu_stats.block_erases > 0, name, "restore: 64 KB block erases");
+  flash_emu_reset_stats();
+  rc = restore_factory();
+  check(rc == 0 && flash_emu_stats.writes == 0 && flash_emu_stats.sector_erases == 0, name,
+    "restore again: nothing rewritten");
+
+  //  A corrupt source is rejected before anything is written
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  memcpy(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE);
+  corrupt(PINETIME_RECOVERY_OFFSET, source_size);
+  flash_emu_reset_stats();
+  rc = restore_factory();
+  check(rc == -1 && flash_emu_stats.writes == 0 && flash_emu_stats.sector_erases == 0 &&
+    memcmp(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE) == 0,
+    name, "restore corrupt: rejected, secondary slot untouched");
+
+  //  Direct install to the primary slot
+  flash_emu_init();
+  emu_reset_log();
+  flash_emu_load(PINETIME_RECOVERY_DEVICE, PINETIME_RECOVERY_OFFSET, source, source_size);
+  fill_slot(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  flash_emu_reset_stats();
+  rc = install_factory();
+  check(rc == 0, name, "install: installed");
+  check(flash_emu_stats.bytes_read[PINETIME_RECOVERY_DEVICE] <= 2 * (source_size + PINETIME_SECTOR_SIZE), name,
+    "install: source read twice at most, to compare and to copy");
+  check(slot_holds(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, image, image_size), name,
+    "install: primary slot holds the image");
+  check(trailer_blank(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET) &&
+    trailer_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET), name, "install: trailers erased");
+  check(log_is(2, (const uint8_t []) { PINETIME_ACTION_INSTALL_STARTED, PINETIME_ACTION_INSTALL }), name,
+    "install: logged as started, then done");
+
+  //  Resuming an install skips the sectors already copied
+  emu_reset_log();
+  flash_emu_reset_stats();
+  rc = install_factory();
+  check(rc == 0 && flash_emu_stats.writes == 0 && flash_emu_stats.sector_erases == 0, name,
+    "install again: nothing rewritten");
+
+  //  A corrupt source is rejected before anything is written
+  fill_slot(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  memcpy(snapshot, flash_emu_data[PINETIME_PRIMARY_DEVICE] + PINETIME_PRIMARY_OFFSET, PINETIME_SLOT_SIZE);
+  corrupt(PINETIME_RECOVERY_OFFSET, source_size);
+  emu_reset_log();
+  rc = install_factory();
+  check(rc == -1 && emu_log_count == 0 &&
+    memcmp(snapshot, flash_emu_data[PINETIME_PRIMARY_DEVICE] + PINETIME_PRIMARY_OFFSET, PINETIME_SLOT_SIZE) == 0,
+    name, "install corrupt: rejected, primary slot untouched");
+  corrupt(PINETIME_RECOVERY_OFFSET, source_size);
+
+  //  A byte that can't be programmed fails the read-back
+  uint32_t stuck = PINETIME_SECTOR_SIZE * 5;
+  while (image[stuck] == 0xff) { stuck++; }
+  flash_emu_stuck(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET + stuck);
+  fill_slot(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  emu_reset_log();
+  rc = install_factory();
+  check(rc == -2, name, "install stuck byte: read-back failed");
+  check(log_is(2, (const uint8_t []) { PINETIME_ACTION_INSTALL_STARTED, PINETIME_ACTION_INSTALL_UNVERIFIED }), name,
+    "install stuck byte: logged as started, then unverified");
+  free(snapshot);
+}
+
+/// Install an update compressed by factory_pack.py --update from the secondary slot
+static void test_update(const uint8_t *packed, uint32_t packed_size, const uint8_t *image, uint32_t image_size) {
+  flash_emu_init();
+  emu_reset_log();
+  fill_slot(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  flash_emu_load(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, packed, packed_size);
+  check(has_compressed_update(), "update", "compressed update detected");
+  int rc = install_compressed_update();
+  check(rc == 1, "update", "installed");
+  check(slot_holds(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, image, image_size), "update",
+    "primary slot holds the image");
+  check(trailer_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET), "update", "secondary trailer erased");
+  check(log_is(1, (const uint8_t []) { PINETIME_ACTION_UPDATE_STARTED }), "update", "logged as started");
+
+  //  A byte that can't be programmed fails the read-back, and the swap stays pending for a retry
+  uint32_t stuck = PINETIME_SECTOR_SIZE * 5;
+  while (image[stuck] == 0xff) { stuck++; }
+  flash_emu_init();
+  emu_reset_log();
+  flash_emu_stuck(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET + stuck);
+  fill_slot(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET);
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  flash_emu_load(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, packed, packed_size);
+  rc = install_compressed_update();
+  check(rc == -2 && !trailer_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET), "update",
+    "stuck byte: read-back failed, swap still pending");
+  check(log_is(2, (const uint8_t []) { PINETIME_ACTION_UPDATE_STARTED, PINETIME_ACTION_UPDATE_UNVERIFIED }), "update",
+    "stuck byte: logged as started, then unverified");
+
+  //  A plain image is left to MCUBoot
+  flash_emu_init();
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  flash_emu_load(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, image, image_size);
+  check(!has_compressed_update() && install_compressed_update() == 0, "update", "plain image left to MCUBoot");
+}
+
+/// Put the old image in the primary slot, and the delta image over an old firmware with a pending MCUBoot trailer in
+/// the secondary slot
+static void load_delta(const uint8_t *image, uint32_t image_size, const uint8_t *delta, uint32_t delta_size) {
+  flash_emu_init();
+  emu_reset_log();
+  flash_emu_load(PINETIME_PRIMARY_DEVICE, PINETIME_PRIMARY_OFFSET, image, image_size);
+  fill_slot(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET);
+  flash_emu_load(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, delta, delta_size);
+}
+
+/// Run pinetime_delta_apply() with a reset before the (skip + 1)th erase of the sector at offset of the secondary
+/// slot. Return non-zero if the reset happened.
+static int apply_with_reset(uint32_t offset, uint32_t skip) {
+  flash_emu_reset_on_erase(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + offset, skip);
+  if (setjmp(flash_emu_reset_point) != 0) { return 1; }
+  pinetime_delta_apply();
+  flash_emu_reset_on_erase(-1, 0, 0);
+  return 0;
+}
+
+/// Rebuild the new image in the secondary slot from the old image in the primary slot and a delta image written by
+/// delta_pack.py, with resets at each step
+static void test_delta(const uint8_t *image, uint32_t image_size, const uint8_t *new_image, uint32_t new_size,
+  const uint8_t *delta, uint32_t delta_size) {
+  uint8_t *snapshot = malloc(PINETIME_SLOT_SIZE);
+  //  The stash ends before the trailer sector, with the header last
+  uint32_t stash_end = PINETIME_SLOT_SIZE - PINETIME_SECTOR_SIZE;
+  uint32_t stash_start = (stash_end - delta_size) / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE;
+
+  load_delta(image, image_size, delta, delta_size);
+  int rc = pinetime_delta_apply();
+  check(rc == 1, "delta", "rebuilt");
+  check(slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, new_image, new_size), "delta",
+    "secondary slot holds the new image");
+  check(range_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + stash_start,
+    PINETIME_SECONDARY_OFFSET + stash_end), "delta", "stash erased");
+  check(!trailer_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET), "delta", "swap still pending");
+  check(pinetime_delta_apply() == 0, "delta", "nothing to rebuild at the next boot");
+
+  //  Reset after stash_delta(): the first erase of the rebuild is the start of the slot
+  load_delta(image, image_size, delta, delta_size);
+  int reset = apply_with_reset(0, 0);
+  check(reset && slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, delta, PINETIME_SECTOR_SIZE),
+    "delta", "reset after stash: start of the slot untouched");
+  rc = pinetime_delta_apply();
+  check(rc == 1 && slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, new_image, new_size), "delta",
+    "reset after stash: rebuild resumed");
+
+  //  Reset during rebuild_image(), with the start of the slot overwritten already
+  load_delta(image, image_size, delta, delta_size);
+  reset = apply_with_reset(new_size / 2 / PINETIME_SECTOR_SIZE * PINETIME_SECTOR_SIZE, 0);
+  check(reset && !slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, delta, PINETIME_SECTOR_SIZE),
+    "delta", "reset during rebuild: start of the slot overwritten");
+  rc = pinetime_delta_apply();
+  check(rc == 1 && slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, new_image, new_size), "delta",
+    "reset during rebuild: rebuild resumed");
+
+  //  Reset during the final erase_range(), which erases the stash header first: the first sector of the stash is
+  //  erased once by stash_delta(), then last by erase_range()
+  load_delta(image, image_size, delta, delta_size);
+  reset = apply_with_reset(stash_start, 1);
+  check(reset && range_blank(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET + stash_end - PINETIME_SECTOR_SIZE,
+    PINETIME_SECONDARY_OFFSET + stash_end), "delta", "reset during stash erase: stash header erased");
+  rc = pinetime_delta_apply();
+  check(rc == 0 && slot_holds(PINETIME_SECONDARY_DEVICE, PINETIME_SECONDARY_OFFSET, new_image, new_size), "delta",
+    "reset during stash erase: new image kept, nothing to rebuild");
+
+  //  A corrupt stream fails its SHA-256 while it is stashed, before the start of the slot is overwritten
+  load_delta(image, image_size, delta, delta_size);
+  flash_emu_data[PINETIME_SECONDARY_DEVICE][PINETIME_SECONDARY_OFFSET + delta_size - 1] ^= 0x01;
+  memcpy(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SECTOR_SIZE);
+  rc = pinetime_delta_apply();
+  check(rc == -1 &&
+    memcmp(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SECTOR_SIZE) == 0,
+    "delta", "corrupt stream: rejected, start of the slot untouched");
+
+  //  A primary slot that doesn't hold the old image is rejected before anything is written
+  load_delta(image, image_size, delta, delta_size);
+  flash_emu_data[PINETIME_PRIMARY_DEVICE][PINETIME_PRIMARY_OFFSET + image_size / 2] ^= 0x01;
+  memcpy(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE);
+  flash_emu_reset_stats();
+  rc = pinetime_delta_apply();
+  check(rc == -1 && flash_emu_stats.writes == 0 && flash_emu_stats.sector_erases == 0 &&
+    memcmp(snapshot, flash_emu_data[PINETIME_SECONDARY_DEVICE] + PINETIME_SECONDARY_OFFSET, PINETIME_SLOT_SIZE) == 0,
+    "delta", "other primary image: rejected, secondary slot untouched");
+  free(snapshot);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 5) {
+    fprintf(stderr, "usage: %s image.bin image.ptz image_new.bin image.ptd\n", argv[0]);
+    return 2;
+  }
+  uint32_t image_size, packed_size, new_size, delta_size;
+  uint8_t *image = read_file(argv[1], &image_size);
+  uint8_t *packed = read_file(argv[2], &packed_size);
+  uint8_t *new_image = read_file(argv[3], &new_size);
+  uint8_t *delta = read_file(argv[4], &delta_size);
+  if (packed_size < PACKED_HEADER_SIZE || memcmp(packed, "PTZ1", 4) != 0) {
+    fprintf(stderr, "%s: not a compressed image\n", argv[2]);
+    return 2;
+  }
+  if (delta_size < sizeof(struct pinetime_delta_header) || memcmp(delta, "PTD1", 4) != 0) {
+    fprintf(stderr, "%s: not a delta image\n", argv[4]);
+    return 2;
+  }
+
+  test_recovery("plain", image, image_size, image, image_size);
+  test_recovery("packed", packed, packed_size, image, image_size);
+  test_update(packed, packed_size, image, image_size);
+  test_delta(image, image_size, new_image, new_size, delta, delta_size);
+
+  printf("%u failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+
+# SPDX-License-Identifier: Apache-2.0
+
+"""Write a test MCUBoot image for factory_emu.
+
+The image has a 32-byte header, a body that looks like firmware (runs of
+repeated words mixed with random bytes, so that factory_pack.py can
+compress it) and a SHA-256 TLV over the header and the body, like
+imgtool writes. The hash is computed here with hashlib, independently of
+the bootloader's pinetime_sha256.c.
+"""
+
+import argparse
+import hashlib
+import random
+import struct
+
+IMAGE_MAGIC = 0x96f3b83d
+HEADER_SIZE = 0x20
+TLV_INFO_MAGIC = 0x6907
+TLV_SHA256 = 0x10
+
+parser = argparse.ArgumentParser(description='Write a test MCUBoot image.')
+parser.add_argument('output', help='MCUBoot image (.bin)')
+parser.add_argument('--size', type=int, default=150000, help='size of the body in bytes')
+parser.add_argument('--seed', type=int, default=1, help='seed of the body contents')
+args = parser.parse_args()
+
+rng = random.Random(args.seed)
+words = [bytes(rng.randrange(256) for _ in range(4)) for _ in range(64)]
+body = bytearray()
+while len(body) < args.size:
+    if rng.random() < 0.7:
+        body += b''.join(rng.choice(words) for _ in range(rng.randrange(1, 8)))
+    else:
+        body += bytes(rng.randrange(256) for _ in range(rng.randrange(1, 16)))
+body = bytes(body[:args.size])
+
+header = struct.pack('<IIHHII8sI', IMAGE_MAGIC, 0, HEADER_SIZE, 0, len(body), 0,
+                     struct.pack('<BBHI', 1, 0, 0, args.seed), 0)
+digest = hashlib.sha256(header + body).digest()
+tlvs = struct.pack('<HH', TLV_SHA256, len(digest)) + digest
+tlv_info = struct.pack('<HH', TLV_INFO_MAGIC, 4 + len(tlvs))
+
+with open(args.output, 'wb') as f:
+    f.write(header + body + tlv_info + tlvs)
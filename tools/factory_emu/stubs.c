@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Host stubs for the watchdog, the info block and the boot log used by pinetime_factory.c and pinetime_delta.c
+#include <string.h>
+#include <hal/hal_watchdog.h>
+#include "pinetime_boot/pinetime_info.h"
+#include "pinetime_boot/pinetime_log.h"
+#include "stubs.h"
+
+struct pinetime_info pinetime_info;
+
+uint8_t emu_log[EMU_LOG_SIZE];
+uint32_t emu_log_count;
+
+void hal_watchdog_tickle(void) {}
+
+void pinetime_info_flash_erase(uint32_t sectors) {
+  pinetime_info.flash_erases += sectors;
+}
+
+void pinetime_info_flash_write(uint32_t bytes) {
+  pinetime_info.flash_writes++;
+  pinetime_info.flash_bytes_written += bytes;
+}
+
+/// Record the action of the info block instead of writing the reboot log page
+void pinetime_log_append(void) {
+  if (emu_log_count < EMU_LOG_SIZE) { emu_log[emu_log_count] = pinetime_info.action; }
+  emu_log_count++;
+}
+
+/// Same as pinetime_info.c, which also holds the info block in retained RAM
+uint32_t pinetime_crc32(const void *buf, uint32_t len) {
+  const uint8_t *data = buf;
+  uint32_t crc = 0xffffffff;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+void emu_reset_log(void) {
+  memset(&pinetime_info, 0, sizeof(pinetime_info));
+  pinetime_info.action = PINETIME_ACTION_RUN;
+  emu_log_count = 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+//  Boot log and info block of the host build
+#ifndef __STUBS_H__
+#define __STUBS_H__
+#include <stdint.h>
+
+#define EMU_LOG_SIZE 16
+
+/// Actions appended to the boot log since the last emu_reset_log()
+extern uint8_t emu_log[EMU_LOG_SIZE];
+extern uint32_t emu_log_count;
+
+/// Clear the boot log and the info block
+void emu_reset_log(void);
+
+#endif  //  __STUBS_H__
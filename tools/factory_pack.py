@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compress a firmware image for the PineTime bootloader.
+
+The output goes to the start of the external SPI flash instead of the
+plain MCUBoot image of the recovery firmware, or with --update to the
+secondary slot instead of the plain image of an update. It is a 16-byte
+header followed by a heatshrink stream (LZSS with a 2^8 byte window and
+matches of up to 2^4 bytes, the parameters compiled into the
+bootloader):
+
+    uint32_t magic          'PTZ1'
+    uint8_t  window_sz2     8
+    uint8_t  lookahead_sz2  4
+    uint16_t reserved       0
+    uint32_t size           size of the MCUBoot image
+    uint32_t packed_size    size of the heatshrink stream
+
+The compressed image must fit in the 256 KB recovery area, or in the
+secondary slot minus its trailer sector. The image itself may be up to
+the size of an MCUBoot slot minus its trailer sector.
+"""
+
+import argparse
+import struct
+import sys
+
+import pinetime_slots
+
+MAGIC = b'PTZ1'
+WINDOW_SZ2 = 8
+LOOKAHEAD_SZ2 = 4
+RECOVERY_AREA_SIZE = pinetime_slots.RECOVERY_SIZE
+MAX_IMAGE_SIZE = pinetime_slots.SLOT_SIZE - pinetime_slots.SECTOR_SIZE  # The trailer sector is left to MCUBoot
+
+class BitWriter:
+    def __init__(self):
+        self.data = bytearray()
+        self.byte = 0
+        self.bits = 0
+
+    def write(self, value, count):
+        for i in reversed(range(count)):
+            self.byte = (self.byte << 1) | ((value >> i) & 1)
+            self.bits += 1
+            if self.bits == 8:
+                self.data.append(self.byte)
+                self.byte = 0
+                self.bits = 0
+
+    def flush(self):
+        if self.bits:
+            self.data.append(self.byte << (8 - self.bits))
+            self.bits = 0
+        return bytes(self.data)
+
+def compress(data):
+    """Greedy LZSS, heatshrink bit stream: 1 + literal, or 0 + (distance - 1) + (count - 1)."""
+    window = 1 << WINDOW_SZ2
+    max_count = 1 << LOOKAHEAD_SZ2
+    out = BitWriter()
+    recent = {}  # Last positions of each 2-byte prefix, newest last
+    i = 0
+    while i < len(data):
+        best_count, best_distance = 0, 0
+        for j in reversed(recent.get(data[i:i + 2], [])):
+            if i - j > window:
+                break
+            count = 0
+            while count < max_count and i + count < len(data) and data[j + count] == data[i + count]:
+                count += 1
+            if count > best_count:
+                best_count, best_distance = count, i - j
+                if count == max_count:
+                    break
+        # A match costs 1 + 8 + 4 bits, a literal 9 bits: worth it from 2 bytes
+        step = best_count if best_count >= 2 else 1
+        if step > 1:
+            out.write(0, 1)
+            out.write(best_distance - 1, WINDOW_SZ2)
+            out.write(best_count - 1, LOOKAHEAD_SZ2)
+        else:
+            out.write(1, 1)
+            out.write(data[i], 8)
+        for k in range(i, i + step):
+            positions = recent.setdefault(data[k:k + 2], [])
+            positions.append(k)
+            if len(positions) > window:
+                del positions[0]
+        i += step
+    return out.flush()
+
+def decompress(packed, size):
+    """Reference decoder, same as pinetime_heatshrink.c."""
+    out = bytearray()
+    bit = 0
+    def get_bits(count):
+        nonlocal bit
+        value = 0
+        for _ in range(count):
+            value = (value << 1) | ((packed[bit // 8] >> (7 - bit % 8)) & 1)
+            bit += 1
+        return value
+    while len(out) < size:
+        if get_bits(1):
+            out.append(get_bits(8))
+        else:
+            distance = get_bits(WINDOW_SZ2) + 1
+            count = get_bits(LOOKAHEAD_SZ2) + 1
+            for _ in range(min(count, size - len(out))):
+                out.append(out[-distance] if distance <= len(out) else 0)
+    return bytes(out)
+
+parser = argparse.ArgumentParser(description='Compress a firmware image for the bootloader.')
+parser.add_argument('image', help='MCUBoot image of the recovery firmware or of the update (.bin)')
+parser.add_argument('output', help='compressed image, to be written at offset 0 of the external flash, or to the secondary slot with --update')
+parser.add_argument('--update', action='store_true',
+                    help='compress an update, to be written to the secondary slot by the OTA update')
+args = parser.parse_args()
+area, area_name = (MAX_IMAGE_SIZE, 'secondary slot') if args.update else (RECOVERY_AREA_SIZE, 'recovery area')
+
+with open(args.image, 'rb') as f:
+    image = f.read()
+if len(image) > MAX_IMAGE_SIZE:
+    sys.exit('{}: image is {} bytes, more than the {} bytes of a slot'.format(args.image, len(image), MAX_IMAGE_SIZE))
+
+packed = compress(image)
+if decompress(packed, len(image)) != image:
+    sys.exit('internal error: compressed image does not decompress to the original')
+header = MAGIC + struct.pack('<BBHII', WINDOW_SZ2, LOOKAHEAD_SZ2, 0, len(image), len(packed))
+if len(header) + len(packed) > area:
+    sys.exit('{}: compressed image is {} bytes, more than the {} bytes of the {}'.format(
+        args.image, len(header) + len(packed), area, area_name))
+
+with open(args.output, 'wb') as f:
+    f.write(header + packed)
+print('{}: {} bytes, compressed to {} bytes ({:.0%})'.format(
+    args.output, len(image), len(header) + len(packed), (len(header) + len(packed)) / len(image)))
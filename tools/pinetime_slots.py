@@ -0,0 +1,26 @@
+# SPDX-License-Identifier: Apache-2.0
+
+"""Flash layout of the PineTime bootloader, shared by the image tools.
+
+The values are read from
+libs/pinetime_boot/include/pinetime_boot/pinetime_slots.h, so that the
+tools and the bootloader agree on the size of the slots and of the
+recovery area.
+"""
+
+import os
+import re
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'libs', 'pinetime_boot', 'include',
+                      'pinetime_boot', 'pinetime_slots.h')
+
+def _read_header():
+    with open(HEADER) as f:
+        text = f.read()
+    return {name: int(value, 0)
+            for name, value in re.findall(r'^#define PINETIME_(\w+)\s+(0x[0-9a-fA-F]+|\d+)', text, re.M)}
+
+_values = _read_header()
+SLOT_SIZE = _values['SLOT_SIZE']
+SECTOR_SIZE = _values['SECTOR_SIZE']
+RECOVERY_SIZE = _values['RECOVERY_SIZE']
@@ -50,7 +50,8 @@ def clut8_rgb565(i):
 
         This function is unused within this file but needs to be
         maintained alongside the reference clut so it is reproduced
-        here.
+        here. The 2-bit decoder in libs/pinetime_boot/src/display.c
+        has a C copy of it.
 
     :param int i: Index (from 0..255 inclusive) into the CLUT
     :return:      16-bit colour in RGB565 format
@@ -268,6 +269,57 @@ def encode_8bit(im):
 
     return (im.width, im.height, bytes(rle))
 
+def row_index(image, stride):
+    """Row index for a 1-bit RLE image.
+
+    The 1-bit format has no random access, so a decoder that wants to start
+    drawing at row N must otherwise walk the runs from the first byte. This
+    records the decoder state at the first pixel of every stride-th row:
+    the index of the next run byte, the number of pixels left in the current
+    run and the row on which the current run started (the boot logo picks
+    the colour of a run from the row it starts on).
+
+    The walk mirrors the row decoder in display.c: a run is only fetched
+    when a pixel of the current row needs it, so a run that starts exactly at
+    the beginning of a row is attributed to that row.
+
+    :param image:  (width, height, rle) tuple from :py:meth:`encode`
+    :param int stride: Number of rows between two entries
+    :return:       List of (index, remaining, run_row) tuples
+    """
+    (sx, sy, rle) = image
+    index = 0
+    remaining = 0
+    run_row = 0
+    entries = []
+
+    for y in range(sy):
+        if y % stride == 0:
+            entries.append((index, remaining, run_row))
+        x = 0
+        while x < sx:
+            while remaining == 0 and index < len(rle):
+                remaining = rle[index]
+                index += 1
+                run_row = y
+            if remaining == 0:
+                break
+            count = min(remaining, sx - x)
+            remaining -= count
+            x += count
+
+    return entries
+
+def render_c_index(entries, fname, indent, stride):
+    extra_indent = ' ' * indent
+    print(f'{extra_indent}// Row index, one entry every {stride} rows: '
+          f'{{ run index, pixels left in run, row of run }}')
+    print(f'{extra_indent}static const struct imgRowIndex '
+          f'{varname(fname)}Index[] = {{')
+    for (index, remaining, run_row) in entries:
+        print(f'{extra_indent}  {{ {index}, {remaining}, {run_row} }},')
+    print(f'{extra_indent}}};')
+
 def render_c(image, fname, indent, depth):
     extra_indent = ' ' * indent
     if len(image) == 3:
@@ -354,6 +406,9 @@ parser.add_argument('--2bit', action='store_true', dest='twobit',
                     help='Generate 2-bit image')
 parser.add_argument('--8bit', action='store_true', dest='eightbit',
                     help='Generate 8-bit image')
+parser.add_argument('--index', default=0, type=int, metavar='STRIDE',
+                    help='With --c, also generate a row index with one entry '
+                         'every STRIDE rows (1-bit images only)')
 
 args = parser.parse_args()
 if args.eightbit:
@@ -371,6 +426,10 @@ for fname in args.files:
 
     if args.c:
         render_c(image, fname, args.indent, depth)
+        if args.index and depth == 1:
+            print()
+            render_c_index(row_index(image, args.index), fname, args.indent,
+                           args.index)
     else:
         render_py(image, fname, args.indent, depth)
 